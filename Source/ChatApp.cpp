@@ -0,0 +1,75 @@
+#include "ChatApp.h"
+
+// ===== Member Set =====
+bool MemberSet::Insert(UserID user_id) {
+        auto [index_it, inserted] = index.try_emplace(user_id, (u32)ids.size());
+        if (!inserted) return false;
+
+        ids.push_back(user_id);
+        return true;
+}
+
+bool MemberSet::Remove(UserID user_id) {
+        auto index_it = index.find(user_id);
+        if (index_it == index.end()) return false;
+
+        // ===== Swap The Last Member Into The Gap =====
+        u32    idx  = index_it->second;
+        UserID last = ids.back();
+
+        ids[idx]    = last;
+        index[last] = idx;
+
+        ids.pop_back();
+        index.erase(user_id);
+
+        return true;
+}
+
+bool MemberSet::Contains(UserID user_id) const {
+        return index.contains(user_id);
+}
+
+u32 MemberSet::Count() const {
+        return (u32)ids.size();
+}
+
+void MemberSet::Clear() {
+        ids.clear();
+        index.clear();
+}
+
+const UserID* MemberSet::begin() const {
+        return ids.data();
+}
+
+const UserID* MemberSet::end() const {
+        return ids.data() + ids.size();
+}
+
+// ===== String Table =====
+StringHandle StringTable::Intern(std::string_view string) {
+        if (string.empty()) return empty_string;
+
+        auto handle_it = handles.find(string);
+        if (handle_it != handles.end()) return handle_it->second;
+
+        strings.emplace_back(string);
+
+        StringHandle handle                       = (StringHandle)strings.size();
+        handles[std::string_view(strings.back())] = handle;
+
+        return handle;
+}
+
+std::string_view StringTable::Get(StringHandle handle) const {
+        if (handle == empty_string or handle > strings.size()) return {};
+
+        return strings[handle - 1];
+}
+
+const char* StringTable::CStr(StringHandle handle) const {
+        if (handle == empty_string or handle > strings.size()) return "";
+
+        return strings[handle - 1].c_str();
+}
@@ -1,23 +1,24 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
+#include <deque>
 #include <stdio.h>
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
-#include <print>
+#include "Platform.h"
 
-#pragma comment(lib, "Ws2_32.lib")
+#include <print>
 
-#define MAX_CHANNEL_USER_COUNT    1'000
-#define MAX_CHANNEL_MESSAGE_COUNT 100
-#define MAX_CHANNEL_COUNT         10
-#define MAX_USER_CHANNELS         100
+#define MAX_CHANNEL_COUNT 10
+#define MAX_USER_CHANNELS 100
 
 constexpr const char* server_port           = "30302";
 constexpr int         message_buffer_length = 512;
 constexpr int         global_chat_id        = 0;
-constexpr int         max_clients           = 100;
 
 using u32 = uint32_t;
 using u64 = uint64_t;
@@ -27,6 +28,7 @@ using ChannelID = u32;
 using TimeStamp = u64;
 
 #include "Message.h"
+#include "History.h"
 
 enum ReservedChannelIDs : ChannelID {
         ChannelIDServer = 0, // Messages for the server, not to be sent to any chat.
@@ -41,27 +43,71 @@ enum class ReturnCode {
         FailedCreatingSocket,
 
         SendMessageFailed,
+        ConnectionClosed,
+        ConnectionTimedOut,
 
         ErrorUnknown,
 };
 
-// Server stores all messages and information on RAM, can move this to a database and then have it be persistent between runs, and also allows more
-// messages to be stored.
+// The members of a channel. Stored densely so fanning out to them is a plain loop, with an index on the side so insert, remove and
+// contains dont have to scan. No fixed limit.
+struct MemberSet {
+        bool Insert(UserID user_id); // False if they were already a member.
+        bool Remove(UserID user_id); // False if they werent a member. Moves the last member into the gap, order isnt kept.
+        bool Contains(UserID user_id) const;
+        u32  Count() const;
+        void Clear();
+
+        const UserID* begin() const;
+        const UserID* end() const;
+
+        std::vector<UserID>             ids;
+        std::unordered_map<UserID, u32> index; // Position of each member in ids.
+};
+
+// Handle to a string in a StringTable. Two equal strings in the same table always have the same handle, so names compare by handle.
+using StringHandle = u32;
+
+constexpr StringHandle empty_string = 0;
+
+// Stores every distinct name once. Strings are never removed, names are few and a rename just adds another one.
+// NOTE: Not thread safe, the server only touches its table under registry_mutex.
+struct StringTable {
+        StringHandle     Intern(std::string_view string);
+        std::string_view Get(StringHandle handle) const;
+        const char*      CStr(StringHandle handle) const; // Null terminated, valid for the tables lifetime.
+
+        std::deque<std::string>                            strings; // Handle - 1, a deque so the strings never move once added.
+        std::unordered_map<std::string_view, StringHandle> handles; // Views into strings.
+};
+
+// One join or leave, kept so a reconnecting client can be sent only the changes it missed.
+struct MemberChange {
+        u64    version; // The channels members_version after this change.
+        UserID user_id;
+        bool   joined;
+};
+
+#define MAX_MEMBER_CHANGES 4'096 // Per channel. A client that missed more than this gets the whole member list again.
+
+// Server keeps users and channels in RAM. Chat messages are also appended to the message log on disk (Log.h), so history can outlive a run.
 struct Channel {
-        ChannelID   id;
-        std::string name;
+        ChannelID    id;
+        StringHandle name{};
 
-        u32    user_count{};
-        UserID users[MAX_CHANNEL_USER_COUNT];
+        MemberSet                 users;
+        u64                       members_version{};      // Bumped on every change to users. The client keeps the version its users match.
+        std::vector<MemberChange> member_changes;         // Server only. Grows up to MAX_MEMBER_CHANGES, then the oldest is overwritten.
+        u32                       oldest_member_change{}; // Where the oldest change is once member_changes is full.
 
-        u32     message_count{};
-        Message messages[MAX_CHANNEL_MESSAGE_COUNT];
+        // NOTE: Only the client keeps messages here, the server keeps them with the channels route so chat messages dont need the registry.
+        MessageHistory history;
 };
 
 struct User {
-        UserID      id;
-        std::string user_name;
-        SOCKET      socket;
-        u32         channel_count;
-        ChannelID   channels[MAX_USER_CHANNELS];
+        UserID       id;
+        StringHandle user_name{};
+        u32          shard; // Server only, the shard that owns this users connection.
+        u32          channel_count;
+        ChannelID    channels[MAX_USER_CHANNELS];
 };
\ No newline at end of file
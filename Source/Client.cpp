@@ -3,10 +3,13 @@
 #include "ChatApp.h"
 #include "Message.h"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <print>
 
+static u64 NewestSeq(MessageHistory& history);
+
 ReturnCode Client::Init() {
         int res;
 
@@ -17,14 +20,25 @@ ReturnCode Client::Init() {
 }
 
 void Client::Shutdown() {
-        shutdown(client_socket, SD_SEND);
-        closesocket(client_socket);
+        StopNetworkThread();
+
+        if (client_socket != INVALID_SOCKET) {
+                shutdown(client_socket, SD_SEND);
+                closesocket(client_socket);
+        }
+        client_socket = INVALID_SOCKET;
         WSACleanup();
 }
 
 ReturnCode Client::Reconnect() {
         int res;
 
+        // ===== Drop The Old Connection =====
+        // NOTE: The network thread has to stop first, it is still reading from the old socket.
+        StopNetworkThread();
+        if (client_socket != INVALID_SOCKET) closesocket(client_socket);
+        client_socket = INVALID_SOCKET;
+
         addrinfo* result{};
         addrinfo* ptr{};
         addrinfo  hints{};
@@ -39,8 +53,8 @@ ReturnCode Client::Reconnect() {
 
         res = getaddrinfo(server_address, server_port, &hints, &result);
         if (res != 0) {
+                // NOTE: Init owns WSAStartup and Shutdown the cleanup, a later Retry still needs winsock.
                 std::println("Failed getaddrinfo function");
-                WSACleanup();
                 return ReturnCode::ErrorUnknown;
         }
 
@@ -68,9 +82,52 @@ ReturnCode Client::Reconnect() {
                 std::println("Error at socket(): {}", WSAGetLastError());
                 std::println("Failed Connecting Socket");
                 closesocket(client_socket);
+                client_socket = INVALID_SOCKET;
                 return ReturnCode::FailedToConnectToSocket;
         }
 
+        // ===== The New Connection Counts As Traffic =====
+        last_sent_ms     = MonotonicMs();
+        last_received_ms = last_sent_ms;
+        server_closed    = false;
+
+        // ===== Forget What Was On Its Way =====
+        server_version      = 0;
+        recv_ring.read_pos  = 0;
+        recv_ring.write_pos = 0;
+        page_remaining      = 0;
+        page_messages.clear();
+        inbox.Clear();
+
+        for (auto& [channel_id, state] : scrollback) {
+                state.requested = false;
+        }
+
+        // ===== Ask Again For Names That Never Came =====
+        name_lookups_queued.assign(name_lookups_pending.begin(), name_lookups_pending.end());
+
+        // ===== Say What We Already Have =====
+        ResyncChannel known_channels[MAX_RESYNC_CHANNELS];
+        u32           known_count = 0;
+        for (u32 channel_idx = 0; channel_idx < channel_count and known_count < MAX_RESYNC_CHANNELS; channel_idx++) {
+                ChannelID channel_id = chat_channels[channel_idx];
+                Channel&  channel    = channels[channel_id];
+
+                known_channels[known_count++] = { channel_id, NewestSeq(channel.history), channel.members_version };
+
+                // NOTE: A first connect gets no pages, so there is nothing to wait for.
+                if (server_epoch == 0) continue;
+
+                ChannelScrollback& state = scrollback[channel_id];
+                state.catching_up        = true;
+                state.held.clear();
+        }
+
+        // ===== Hello Has To Be The First Frame =====
+        SendToServer(ResyncHello(server_epoch, known_channels, known_count), FrameHello);
+
+        StartNetworkThread();
+
         return ReturnCode::Success;
 }
 
@@ -93,12 +150,11 @@ ReturnCode Client::SendMessage(ChannelID channel, const std::string& message_str
         message.channel        = channel;
         message.timestamp      = duration.count();
         // If string is too long, will just cut off the end.
-        message.content_length = (u32)min((u32)message_string.length(), (u32)message_buffer_length);
+        message.content_length = std::min((u32)message_string.length(), (u32)message_buffer_length);
         message_string.copy(message.content, message.content_length);
 
         // ===== Send Message =====
-        int send_flags = 0;
-        res            = send(client_socket, (char*)&message, sizeof(Message), send_flags);
+        res = SendToServer(message);
 
         // ===== Process Error =====
         // TODO: Process failed message send, need to check server connection.
@@ -119,9 +175,14 @@ ReturnCode Client::Ping() {
         memcpy(&message.content[0], &message_type, sizeof(ServerMessageType));
         message.content_length += sizeof(ServerMessageType);
 
+        // ===== Write When It Was Sent =====
+        // NOTE: Comes back in the pong for the round trip time.
+        last_ping_ms = MonotonicMs();
+        memcpy(&message.content[message.content_length], &last_ping_ms, sizeof(u64));
+        message.content_length += sizeof(u64);
+
         // ===== Send Message =====
-        int send_flags = 0;
-        int res        = send(client_socket, (char*)&message, sizeof(Message), send_flags);
+        int res = SendToServer(message);
 
         if (res == SOCKET_ERROR) {
                 std::println("Failed sending message");
@@ -131,6 +192,31 @@ ReturnCode Client::Ping() {
         return ReturnCode::Success;
 }
 
+ReturnCode Client::Heartbeat() {
+        u64 now_ms = MonotonicMs();
+
+        if (server_closed) return ReturnCode::ConnectionClosed;
+
+        // ===== Server Has Gone Silent =====
+        // NOTE: It answers every ping, so this is a few unanswered pings in a row.
+        if (now_ms - last_received_ms > HEARTBEAT_MISS_LIMIT * heartbeat_interval_ms) {
+                std::println("Server stopped responding");
+                return ReturnCode::ConnectionTimedOut;
+        }
+
+        // ===== Only Ping A Quiet Link =====
+        // NOTE: Both ways, the server needs to hear from us and we need to hear from it.
+        bool quiet = now_ms - last_sent_ms >= heartbeat_interval_ms or now_ms - last_received_ms >= heartbeat_interval_ms;
+        if (!quiet or now_ms - last_ping_ms < heartbeat_interval_ms) return ReturnCode::Success;
+
+        return Ping();
+}
+
+int Client::SendToServer(const Message& message, FrameType type) {
+        last_sent_ms = MonotonicMs();
+        return SendFrame(client_socket, message, type);
+}
+
 void Client::CreatePrivateMessageChannel(UserID user_id) {
         Message message{};
 
@@ -147,8 +233,7 @@ void Client::CreatePrivateMessageChannel(UserID user_id) {
         message.content_length += sizeof(UserID);
 
         // ===== Send Message =====
-        int send_flags = 0;
-        send(client_socket, (char*)&message, sizeof(Message), send_flags);
+        SendToServer(message);
 }
 
 void Client::InviteUserToChannel(UserID user_id, ChannelID channel_id) {
@@ -171,37 +256,292 @@ void Client::InviteUserToChannel(UserID user_id, ChannelID channel_id) {
         message.content_length += sizeof(UserID);
 
         // ===== Send Message =====
-        int send_flags = 0;
-        send(client_socket, (char*)&message, sizeof(Message), send_flags);
+        SendToServer(message);
 }
 
-void Client::ProcessMessages() {
-        int     res;
-        Message message;
+ReturnCode Client::RequestHistory(ChannelID channel, u64 cursor, HistoryDirection direction, u32 limit) {
+        Message message{};
+
+        message.channel   = ChannelIDServer;
+        message.timestamp = 0;
+
+        u16 page_limit = (u16)std::min(limit, (u32)MAX_HISTORY_PAGE);
+
+        // ===== Write Request =====
+        ServerMessageType message_type = MessageHistoryRequest;
+        memcpy(&message.content[0], &message_type, sizeof(ServerMessageType));
+        memcpy(&message.content[4], &channel, sizeof(ChannelID));
+        memcpy(&message.content[8], &cursor, sizeof(u64));
+        memcpy(&message.content[16], &direction, sizeof(u8));
+        memcpy(&message.content[17], &page_limit, sizeof(u16));
+        message.content_length = 19;
+
+        // ===== Send Message =====
+        int res = SendToServer(message);
+
+        if (res == SOCKET_ERROR) {
+                std::println("Failed sending message");
+                return ReturnCode::SendMessageFailed;
+        }
+
+        return ReturnCode::Success;
+}
+
+// Join and leave notices are only kept locally and have no seq, skip past them.
+static u64 OldestSeq(MessageHistory& history) {
+        for (u32 idx = 0; idx < history.Count(); idx++) {
+                if (history.Get(idx).seq != 0) return history.Get(idx).seq;
+        }
+
+        return 0;
+}
+
+static u64 NewestSeq(MessageHistory& history) {
+        for (u32 idx = history.Count(); idx-- > 0;) {
+                if (history.Get(idx).seq != 0) return history.Get(idx).seq;
+        }
+
+        return 0;
+}
+
+void Client::RequestOlderHistory(ChannelID channel) {
+        auto channel_it = channels.find(channel);
+        if (channel_it == channels.end()) return;
+
+        ChannelScrollback& state = scrollback[channel];
+        if (state.requested or state.exhausted) return;
+
+        // NOTE: With nothing to go on yet, a cursor of 0 asks for the newest page.
+        if (RequestHistory(channel, OldestSeq(channel_it->second.history), HistoryBefore) == ReturnCode::Success) state.requested = true;
+}
+
+void Client::RequestUserName(UserID user_id) {
+        if (!name_lookups_pending.insert(user_id).second) return;
+
+        name_lookups_queued.push_back(user_id);
+}
+
+void Client::FlushNameLookups() {
+        // NOTE: Held until the servers hello, it decides which request we can use.
+        if (name_lookups_queued.empty() or server_version == 0) return;
+
+        for (u32 id_idx = 0; id_idx < name_lookups_queued.size();) {
+                Message message{};
+                message.channel = ChannelIDServer;
+
+                // ===== Version 3, One ID Per Request =====
+                if (server_version < 4) {
+                        ServerMessageType message_type = MessageUserNameRequest;
+                        memcpy(&message.content[0], &message_type, sizeof(ServerMessageType));
+                        memcpy(&message.content[sizeof(ServerMessageType)], &name_lookups_queued[id_idx], sizeof(UserID));
+                        message.content_length = sizeof(ServerMessageType) + sizeof(UserID);
+
+                        SendToServer(message);
+                        id_idx++;
+                        continue;
+                }
+
+                // ===== As Many IDs As Fit =====
+                u16 count = (u16)std::min((u32)name_lookups_queued.size() - id_idx, (u32)MAX_NAME_LOOKUPS);
+
+                ServerMessageType message_type = MessageUserNamesRequest;
+                memcpy(&message.content[0], &message_type, sizeof(ServerMessageType));
+                memcpy(&message.content[sizeof(ServerMessageType)], &count, sizeof(u16));
+                memcpy(&message.content[NAME_LOOKUP_HEADER_SIZE], &name_lookups_queued[id_idx], count * sizeof(UserID));
+                message.content_length = NAME_LOOKUP_HEADER_SIZE + count * sizeof(UserID);
+
+                SendToServer(message);
+                id_idx += count;
+        }
 
-        while (true) {
+        name_lookups_queued.clear();
+}
+
+void Client::FinishHistoryPage() {
+        ChannelScrollback& state = scrollback[page_channel];
+        state.requested          = false;
+
+        // NOTE: The channel can have been left while the page was on its way.
+        auto channel_it = channels.find(page_channel);
+        if (channel_it != channels.end()) {
+                MessageHistory& history = channel_it->second.history;
+
+                if (page_direction == HistoryBefore) {
+                        // ===== Add In Front, Newest First =====
+                        // NOTE: Skip anything we already have, messages can arrive live while the page is being put together.
+                        u64  oldest_seq = OldestSeq(history);
+                        bool full       = false;
+                        for (u32 idx = (u32)page_messages.size(); idx-- > 0 and !full;) {
+                                if (oldest_seq != 0 and page_messages[idx].seq >= oldest_seq) continue;
+
+                                full = !history.PushFront(page_messages[idx]);
+                        }
+
+                        state.exhausted = full or !page_has_more;
+                } else {
+                        // ===== Add After, Oldest First =====
+                        u64 newest_seq = NewestSeq(history);
+
+                        // NOTE: We missed more than a page, what we have doesnt join up with it. Start again from this page, the rest can
+                        // be scrolled back to.
+                        if (!page_messages.empty() and newest_seq != 0 and page_messages[0].seq > newest_seq + 1) {
+                                history.Clear();
+                                newest_seq      = 0;
+                                state.exhausted = false;
+                        }
+
+                        for (const Message& message : page_messages) {
+                                if (message.seq > newest_seq) history.Push(message);
+                        }
+
+                        // ===== Caught Up, Add What Arrived Meanwhile =====
+                        // NOTE: If the server had nothing after our newest, all of them are new even when their seqs are lower. It can have
+                        // been restarted without its log.
+                        if (state.catching_up) {
+                                newest_seq = NewestSeq(history);
+                                for (const Message& message : state.held) {
+                                        if (page_messages.empty() or message.seq > newest_seq) history.Push(message);
+                                }
+                        }
+                }
+        }
+
+        if (page_direction == HistoryAfter) {
+                state.catching_up = false;
+                state.held.clear();
+        }
+
+        page_messages.clear();
+}
+
+void Client::StartNetworkThread() {
+        network_running = true;
+        network_thread  = std::thread(&Client::NetworkLoop, this);
+}
+
+void Client::StopNetworkThread() {
+        network_running = false;
+        if (network_thread.joinable()) network_thread.join();
+}
+
+// Reads and decodes frames as soon as they arrive, however long the render thread takes to draw a frame. Stops on its own when the
+// connection fails, Heartbeat then reports it.
+void Client::NetworkLoop() {
+        u32  frame_size;
+        bool invalid;
+
+        while (network_running) {
                 fd_set sockets_to_check{};
                 sockets_to_check.fd_count    = 1;
                 sockets_to_check.fd_array[0] = client_socket;
 
-                timeval time_out_duration{ 0, 1 };
+                // NOTE: Times out so we notice being stopped.
+                timeval time_out_duration{ 0, NETWORK_POLL_TIMEOUT_MS * 1'000 };
                 int     num_sockets_ready = select(0, &sockets_to_check, nullptr, nullptr, &time_out_duration);
-                if (num_sockets_ready == 0) break; // If no messages we just return
+                if (num_sockets_ready == 0) continue;
+
+                // ===== Read Everything That Is Ready =====
+                // NOTE: Ready with nothing to read, the server closed the connection.
+                int res = num_sockets_ready > 0 ? recv_ring.Fill(client_socket) : SOCKET_ERROR;
+                if (res <= 0) {
+                        server_closed = true;
+                        NotifyNetworkEvent();
+                        return;
+                }
+
+                last_received_ms = MonotonicMs();
+
+                while (const char* frame = recv_ring.NextFrame(frame_size, invalid)) {
+                        InboundFrame inbound;
+                        DecodeFrame(frame, inbound.type, inbound.message);
+                        recv_ring.Consume(frame_size);
+
+                        // ===== Wait For The Render Thread If It Is Behind =====
+                        // NOTE: Rather than drop anything, this stops reading and lets the socket buffer fill instead.
+                        if (!inbox.Push(inbound)) {
+                                // NOTE: Woken first, a sleeping render thread would otherwise leave us waiting on it.
+                                NotifyNetworkEvent();
+                                while (!inbox.Push(inbound)) {
+                                        if (!network_running) return;
+                                        std::this_thread::yield();
+                                }
+                        }
+                }
+
+                if (invalid) {
+                        std::println("Server sent an invalid frame");
+                        server_closed = true;
+                }
 
-                int recieve_flags = 0;
-                res               = recv(client_socket, (char*)&message, sizeof(message), recieve_flags);
+                // NOTE: Once per read, not per frame, a burst of frames is applied in one go.
+                NotifyNetworkEvent();
+                if (invalid) return;
+        }
+}
 
-                if (res == INVALID_SOCKET) return;
+void Client::NotifyNetworkEvent() {
+        if (on_network_event != nullptr) on_network_event();
+}
 
-                if (message.sender == 0) {
-                        // ===== Proccess Message from Server ======
-                        ProcessServerMessage(message);
-                } else {
-                        // ===== Proccess Message from Users ======
-                        Channel& channel                        = channels[message.channel];
-                        channel.messages[channel.message_count] = message;
-                        channel.message_count++;
+void Client::ProcessMessages() {
+        while (InboundFrame* inbound = inbox.Front()) {
+                ProcessFrame(inbound->type, inbound->message);
+                inbox.Pop();
+        }
+}
+
+void Client::ProcessFrame(FrameType type, const Message& message) {
+        if (type == FrameHello) {
+                // ===== Agree On A Version =====
+                u8 peer_version = message.content_length > 0 ? (u8)message.content[0] : 0;
+                if (peer_version < min_protocol_version) {
+                        std::println("Server protocol version {} is not supported", peer_version);
+                        return;
                 }
+
+                server_version = std::min(peer_version, protocol_version);
+
+                u64 epoch = 0;
+                if (message.content_length >= 1 + sizeof(u64)) memcpy(&epoch, &message.content[1], sizeof(u64));
+
+                // ===== Forget Names From Another Run =====
+                // NOTE: A restarted server can hand an ID we have a name for to someone else, see Slot Map IDs. Servers too old to send an
+                // epoch cant tell us, so they are treated as a new run every time.
+                if (epoch == 0 or epoch != server_epoch) {
+                        users.clear();
+                        name_lookups_queued.clear();
+                        name_lookups_pending.clear();
+                }
+
+                server_epoch = epoch;
+                return;
+        }
+
+        if (type != FrameMessage) return;
+
+        // ===== Frames Of The Page Being Received =====
+        if (page_remaining > 0 and message.sender != 0 and message.channel == page_channel) {
+                page_messages.push_back(message);
+                page_remaining--;
+
+                if (page_remaining == 0) FinishHistoryPage();
+                return;
+        }
+
+        if (message.sender == 0) {
+                // ===== Proccess Message from Server ======
+                ProcessServerMessage(message);
+        } else {
+                // ===== Proccess Message from Users ======
+                // NOTE: Held back while catching up, the missed messages are older and go in first.
+                auto state_it = scrollback.find(message.channel);
+                if (state_it != scrollback.end() and state_it->second.catching_up) {
+                        state_it->second.held.push_back(message);
+                        return;
+                }
+
+                Channel& channel = channels[message.channel];
+                channel.history.Push(message);
         }
 }
 
@@ -231,20 +571,33 @@ void Client::ProcessServerMessage(const Message& message) {
 
                         std::println("Sync Channel: {}, with user: {}", message.channel, user_id);
 
-                        bool exists = false;
-                        for (u32 user_idx = 0; user_idx < channel.user_count; user_idx++) {
-                                UserID existing_user_id = channel.users[user_idx];
-                                if (user_id == existing_user_id) {
-                                        exists = true;
-                                }
-                        }
+                        channel.users.Insert(user_id);
+                }
+
+                // NOTE: Only on the last one for the channel.
+                if (message.seq != 0) channel.members_version = message.seq;
+        } break;
+        case MessageUserListDiff: {
+                // ===== Apply Who Joined And Left While We Were Away =====
+                Channel& channel = channels[message.channel];
+
+                u8  flags;
+                u16 added_count;
+                memcpy(&flags, &message.content[4], sizeof(u8));
+                memcpy(&added_count, &message.content[5], sizeof(u16));
+
+                if (flags & MemberDiffReset) channel.users.Clear();
+
+                u32 user_count = (message.content_length - 7) / sizeof(UserID);
+                for (u32 i = 0; i < user_count; i++) {
+                        UserID user_id;
+                        memcpy(&user_id, &message.content[7 + i * sizeof(UserID)], sizeof(UserID));
 
-                        if (exists) continue;
-                        message.content[sizeof(ServerMessageType) + sizeof(UserID)];
-                        channel.users[channel.user_count] = user_id;
-                        channel.user_count++;
+                        if (i < added_count) channel.users.Insert(user_id);
+                        else channel.users.Remove(user_id);
                 }
 
+                if (message.seq != 0) channel.members_version = message.seq;
         } break;
         case MessageUserJoin: {
                 // ===== Add User to Channel =====
@@ -253,32 +606,21 @@ void Client::ProcessServerMessage(const Message& message) {
                 UserID new_user;
                 memcpy(&new_user, &message.content[sizeof(ServerMessageType)], sizeof(UserID));
 
-                u32         user_name_length = message.content_length - (sizeof(ServerMessageType) + sizeof(UserID));
-                std::string new_user_name(&message.content[sizeof(ServerMessageType) + sizeof(UserID)], user_name_length);
+                u32 user_name_length = message.content_length - (sizeof(ServerMessageType) + sizeof(UserID));
 
-                bool user_exists = false;
-                for (u32 user_idx = 0; user_idx < channel.user_count; user_idx++) {
-                        UserID user_id = channel.users[user_idx];
-                        if (user_id == new_user) {
-                                user_exists = true;
-                                break;
-                        }
-                }
+                channel.users.Insert(new_user);
 
-                if (!user_exists) {
-                        channel.users[channel.user_count] = new_user;
-                        channel.user_count++;
-                }
+                users[new_user].id        = new_user;
+                users[new_user].user_name = names.Intern(std::string_view(&message.content[sizeof(ServerMessageType) + sizeof(UserID)], user_name_length));
 
                 // ===== Store Message To Display Join =====
                 Message     display_message = message;
                 const char* joined_text     = " Joined";
-                new_user_name.copy(display_message.content, user_name_length);
+                memcpy(display_message.content, names.CStr(users[new_user].user_name), user_name_length);
                 memcpy(&display_message.content[user_name_length], joined_text, 8);
                 display_message.content_length = user_name_length + 8;
 
-                channel.messages[channel.message_count] = display_message;
-                channel.message_count++;
+                channel.history.Push(display_message);
         } break;
         case MessageUserLeave: {
                 UserID leaving_user;
@@ -286,32 +628,25 @@ void Client::ProcessServerMessage(const Message& message) {
 
                 User& user = users[leaving_user];
 
-                u32         user_name_length = message.content_length - (sizeof(ServerMessageType) + sizeof(UserID));
-                std::string leaving_user_name(&message.content[sizeof(ServerMessageType) + sizeof(UserID)], user_name_length);
+                u32         user_name_length  = message.content_length - (sizeof(ServerMessageType) + sizeof(UserID));
+                const char* leaving_user_name = &message.content[sizeof(ServerMessageType) + sizeof(UserID)];
 
                 // ===== Remove User from All Channel =====
                 for (u32 channel_idx = 0; channel_idx < user.channel_count; channel_idx++) {
                         ChannelID channel_id = user.channels[channel_idx];
                         Channel&  channel    = channels[channel_id];
 
-                        for (u32 user_idx = 0; user_idx < channel.user_count; user_idx++) {
-                                if (channel.users[user_idx] != leaving_user) continue;
-
-                                channel.user_count--;
-                                channel.users[user_idx] = channel.users[channel.user_count];
-                                break;
-                        }
+                        channel.users.Remove(leaving_user);
 
 
                         // ===== Store Message To Display Leave =====
                         Message     display_message = message;
                         const char* left_text       = " Left";
-                        leaving_user_name.copy(display_message.content, user_name_length);
+                        memcpy(display_message.content, leaving_user_name, user_name_length);
                         memcpy(&display_message.content[user_name_length], left_text, 6);
                         display_message.content_length = user_name_length + 6;
 
-                        channel.messages[channel.message_count] = display_message;
-                        channel.message_count++;
+                        channel.history.Push(display_message);
                 }
         } break;
         case MessageUserLeaveChannel: {
@@ -321,30 +656,24 @@ void Client::ProcessServerMessage(const Message& message) {
                 UserID leaving_user;
                 memcpy(&leaving_user, &message.content[sizeof(ServerMessageType)], sizeof(UserID));
 
-                u32         user_name_length = message.content_length - (sizeof(ServerMessageType) + sizeof(UserID));
-                std::string leaving_user_name(&message.content[sizeof(ServerMessageType) + sizeof(UserID)], user_name_length);
-
-                for (u32 user_idx = 0; user_idx < channel.user_count; user_idx++) {
-                        if (channel.users[user_idx] != leaving_user) continue;
+                u32         user_name_length  = message.content_length - (sizeof(ServerMessageType) + sizeof(UserID));
+                const char* leaving_user_name = &message.content[sizeof(ServerMessageType) + sizeof(UserID)];
 
-                        channel.user_count--;
-                        channel.users[user_idx] = channel.users[channel.user_count];
-                        break;
-                }
+                channel.users.Remove(leaving_user);
 
                 // ===== Store Message To Display Leave =====
                 Message     display_message = message;
                 const char* joined_text     = " Left";
-                leaving_user_name.copy(display_message.content, user_name_length);
+                memcpy(display_message.content, leaving_user_name, user_name_length);
                 memcpy(&display_message.content[user_name_length], joined_text, 6);
                 display_message.content_length = user_name_length + 6;
 
-                channel.messages[channel.message_count] = display_message;
-                channel.message_count++;
+                channel.history.Push(display_message);
 
                 // ===== If This is The Leaver Remove =====
                 if (leaving_user == id) {
                         channels.erase(message.channel);
+                        scrollback.erase(message.channel);
                         for (u32 channel_idx = 0; channel_idx < channel_count; channel_idx++) {
                                 if (chat_channels[channel_idx] == message.channel) {
                                         channel_count--;
@@ -360,7 +689,52 @@ void Client::ProcessServerMessage(const Message& message) {
 
                 u32 user_name_length = message.content_length - (sizeof(ServerMessageType) + sizeof(UserID));
                 users[user_id].id    = user_id;
-                users[user_id].user_name.assign(&message.content[sizeof(ServerMessageType) + sizeof(UserID)], user_name_length);
+                users[user_id].user_name = names.Intern(std::string_view(&message.content[sizeof(ServerMessageType) + sizeof(UserID)], user_name_length));
+
+                name_lookups_pending.erase(user_id);
+        } break;
+        case MessageUserNamesSend: {
+                u16 count;
+                memcpy(&count, &message.content[sizeof(ServerMessageType)], sizeof(u16));
+
+                // NOTE: Never trust the count, only read entries that are actually there.
+                u32 offset = NAME_LOOKUP_HEADER_SIZE;
+                for (u32 name_idx = 0; name_idx < count and offset + NAME_LOOKUP_ENTRY_SIZE <= message.content_length; name_idx++) {
+                        UserID user_id;
+                        u16    name_length;
+                        memcpy(&user_id, &message.content[offset], sizeof(UserID));
+                        memcpy(&name_length, &message.content[offset + sizeof(UserID)], sizeof(u16));
+                        if (offset + NAME_LOOKUP_ENTRY_SIZE + name_length > message.content_length) break;
+
+                        // NOTE: Empty if the server doesnt know them anymore, still given a name so they arent asked for again.
+                        std::string_view user_name(&message.content[offset + NAME_LOOKUP_ENTRY_SIZE], name_length);
+                        users[user_id].id        = user_id;
+                        users[user_id].user_name = names.Intern(name_length > 0 ? user_name : "Unknown");
+
+                        name_lookups_pending.erase(user_id);
+                        offset += NAME_LOOKUP_ENTRY_SIZE + name_length;
+                }
+        } break;
+        case MessagePong: {
+                // ===== Round Trip Time =====
+                u64 sent_ms;
+                memcpy(&sent_ms, &message.content[4], sizeof(u64));
+
+                // NOTE: Smoothed the same way as TCP, one slow pong shouldnt swing it.
+                u32 sample_ms = (u32)(MonotonicMs() - sent_ms);
+                rtt_ms        = rtt_ms == 0 ? sample_ms : (rtt_ms * 7 + sample_ms) / 8;
+        } break;
+        case MessageHistoryPage: {
+                // ===== Its Frames Come Next =====
+                memcpy(&page_channel, &message.content[4], sizeof(ChannelID));
+                memcpy(&page_remaining, &message.content[16], sizeof(u32));
+                memcpy(&page_direction, &message.content[20], sizeof(u8));
+                page_has_more = message.content[21] != 0;
+
+                page_messages.clear();
+                page_messages.reserve(page_remaining);
+
+                if (page_remaining == 0) FinishHistoryPage();
         } break;
         case MessageUserNewChannel: {
                 // ===== Channel ID =====
@@ -387,7 +761,7 @@ void Client::ProcessServerMessage(const Message& message) {
 
                 // ===== Channel Name ======
                 u32 channel_name_length = message.content_length - (sizeof(ServerMessageType) + sizeof(ChannelID));
-                channels[channel_id].name.assign(&message.content[sizeof(ServerMessageType) + sizeof(ChannelID)], channel_name_length);
+                channels[channel_id].name = names.Intern(std::string_view(&message.content[sizeof(ServerMessageType) + sizeof(ChannelID)], channel_name_length));
         } break;
         }
 }
@@ -411,13 +785,12 @@ void Client::LeaveChannel(ChannelID id) {
         message.content_length += sizeof(ChannelID);
 
         // ===== Send Message =====
-        int send_flags = 0;
-        send(client_socket, (char*)&message, sizeof(Message), send_flags);
+        SendToServer(message);
 }
 
-void Client::AddChannel(ChannelID id, const std::string& channel_name) {
+void Client::AddChannel(ChannelID id, std::string_view channel_name) {
         chat_channels[channel_count] = id;
         channel_count++;
 
-        channels[id].name = channel_name;
+        channels[id].name = names.Intern(channel_name);
 }
\ No newline at end of file
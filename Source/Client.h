@@ -2,37 +2,103 @@
 
 #include "ChatApp.h"
 #include "Message.h"
+#include "SpscQueue.h"
 
+#include <atomic>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #define MAX_CHAT_CHANNEL_COUNT 1'000
 
+#define CLIENT_INBOX_CAPACITY   1'024 // Frames the network thread can get ahead of the render thread by.
+#define NETWORK_POLL_TIMEOUT_MS 100   // How long the network thread waits on the socket before checking if it should stop.
+
+// A frame the network thread has read and decoded, waiting for the render thread.
+struct InboundFrame {
+        FrameType type;
+        Message   message;
+};
+
+// How much of a channels history has been loaded from the server.
+struct ChannelScrollback {
+        bool requested{}; // A page is on its way, only one at a time.
+        bool exhausted{}; // Nothing older on the server, or our history is full.
+
+        // Waiting for the page of messages missed while disconnected. Live messages are held until it arrives so they stay in order.
+        bool                 catching_up{};
+        std::vector<Message> held;
+};
+
 struct Client {
         ReturnCode Init();
         void       Shutdown();
 
+        // Once connected before, the hello asks the server for only what was missed in each channel we still have.
         ReturnCode Reconnect();
 
         // ===== Functions to send messages to the server =====
         ReturnCode SendUserName(const std::string& user_name);
         ReturnCode SendMessage(ChannelID channel, const std::string& message);
         ReturnCode Ping();
+        // Call every frame. Only pings once the link has gone quiet, see Heartbeat. Fails if the server has stopped answering.
+        ReturnCode Heartbeat();
         void       CreatePrivateMessageChannel(UserID user_id);
         void       InviteUserToChannel(UserID user_id, ChannelID channel_id);
+        ReturnCode RequestHistory(ChannelID channel, u64 cursor, HistoryDirection direction, u32 limit = MAX_HISTORY_PAGE);
+        // Asks for the page before the oldest message we have, unless one is already on its way or there is nothing older.
+        void       RequestOlderHistory(ChannelID channel);
+        // Queues a lookup of the users name unless one is already on its way. Nothing is sent until FlushNameLookups, see Name Lookups.
+        void       RequestUserName(UserID user_id);
+        // Sends everything queued this frame in as few requests as fit, call after whatever could have queued lookups.
+        void       FlushNameLookups();
+
+        // Every send goes through here, so the heartbeat knows the link is in use.
+        int SendToServer(const Message& message, FrameType type = FrameMessage);
+
+        // ===== Network Thread =====
+        // NOTE: Only receives. Everything the frames change is owned by the render thread, which applies them in ProcessMessages.
+        void StartNetworkThread();
+        void StopNetworkThread(); // Joins it, the socket is left open.
+        void NetworkLoop();
+        void NotifyNetworkEvent();
 
         // ===== Functions to process messages from the server =====
+        // Applies everything the network thread has received since the last call, call once per frame.
         void ProcessMessages();
+        void ProcessFrame(FrameType type, const Message& message);
         void ProcessServerMessage(const Message& message);
+        void FinishHistoryPage();
 
         // ===== Util functions =====
         void LeaveChannel(ChannelID id);
-        void AddChannel(ChannelID id, const std::string& channel_name);
+        void AddChannel(ChannelID id, std::string_view channel_name);
 
         // ===== Socket Data =====
         WSADATA wsa_data;
         SOCKET  client_socket{ INVALID_SOCKET };
+        u8      server_version{}; // Negotiated protocol version, 0 until the servers hello arrives.
+        u64     server_epoch{};   // From the servers hello, 0 until we have connected once. See Resync.
+
+        RecvRing recv_ring; // Network thread only.
+
+        std::thread                                    network_thread;
+        std::atomic<bool>                              network_running{};
+        SpscQueue<InboundFrame, CLIENT_INBOX_CAPACITY> inbox; // Network thread pushes, render thread pops.
+
+        // Called on the network thread once frames are in the inbox or the server has gone, so a render thread that sleeps while nothing
+        // happens can wake up and apply them. Set before Init. NOTE: Must be safe to call from any thread and return quickly.
+        void (*on_network_event)(){};
+
+        // ===== Heartbeat =====
+        u32               heartbeat_interval_ms{ HEARTBEAT_INTERVAL_MS };
+        u64               last_sent_ms{};     // MonotonicMs of our last send.
+        std::atomic<u64>  last_received_ms{}; // MonotonicMs of the last bytes from the server, set by the network thread.
+        u64               last_ping_ms{};
+        u32               rtt_ms{};           // Smoothed round trip time from pongs, 0 until the first one arrives.
+        std::atomic<bool> server_closed{};    // Seen by the network thread, Heartbeat reports it.
 
         // ===== ID =====
         UserID id;
@@ -44,5 +110,23 @@ struct Client {
         std::unordered_map<ChannelID, Channel> channels{};
 
         // ===== User Data =====
+        // NOTE: Kept across channel switches and reconnects to the same server run. Cleared once the hello shows a different epoch, IDs
+        // are only unique within one run of the server.
         std::unordered_map<UserID, User> users{};
+
+        // ===== Name Lookups =====
+        std::vector<UserID>        name_lookups_queued;  // Not sent yet.
+        std::unordered_set<UserID> name_lookups_pending; // Queued or sent and not answered yet, queued again after a reconnect.
+
+        StringTable names; // User and channel names.
+
+        // ===== History Pages =====
+        std::unordered_map<ChannelID, ChannelScrollback> scrollback;
+
+        // The page whose frames are still arriving, they are held until the last one so a page is added all at once.
+        ChannelID            page_channel{};
+        HistoryDirection     page_direction{};
+        bool                 page_has_more{};
+        u32                  page_remaining{};
+        std::vector<Message> page_messages;
 };
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include "imgui.h"
 #include "imgui_impl_dx12.h"
 #include "imgui_impl_win32.h"
+#include <algorithm>
 #include <d3d12.h>
 #include <dxgi1_5.h>
 #include <tchar.h>
@@ -35,6 +36,20 @@ static const int APP_SRV_HEAP_SIZE        = 64;
 ImFont* main_font;
 ImFont* message_font;
 
+// ===== Redraw =====
+// Frames are only drawn when something could have changed, in between the loop sleeps. Window messages (input, resizes) wake it, so does the
+// client network thread once frames arrive, see WakeGUI, and a timer so the heartbeat still runs on a quiet link.
+// NOTE: ImGui needs a couple of frames to settle after input (hovering, popups opening, scrolling set the frame before), so each wake draws a few.
+#define REDRAW_FRAMES_AFTER_EVENT 3
+#define IDLE_WAKE_INTERVAL_MS     (HEARTBEAT_INTERVAL_MS / 2)
+
+static HWND g_hWnd = nullptr;
+
+// Any thread. WM_NULL does nothing, it only wakes the main loop.
+static void WakeGUI() {
+        ::PostMessageW(g_hWnd, WM_NULL, 0, 0);
+}
+
 struct FrameContext {
         ID3D12CommandAllocator* CommandAllocator;
         UINT64                  FenceValue;
@@ -137,6 +152,7 @@ int GUI() {
         ::RegisterClassExW(&wc);
         HWND hwnd = ::CreateWindowW(wc.lpszClassName, L"Chat App", WS_OVERLAPPEDWINDOW, 100, 100, (int)(1'280 * main_scale),
                                     (int)(800 * main_scale), nullptr, nullptr, wc.hInstance, nullptr);
+        g_hWnd = hwnd;
 
         // Initialize Direct3D
         if (!CreateDeviceD3D(hwnd)) {
@@ -158,6 +174,7 @@ int GUI() {
         io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;  // Enable Gamepad Controls
         io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;     // Enable Gamepad Controls
         io.ConfigInputTextEnterKeepActive = true;
+        io.ConfigInputTextCursorBlink     = false; // NOTE: Blinking would need a redraw twice a second while idle, see Redraw.
 
         // Setup Dear ImGui style
         ImGui::StyleColorsDark();
@@ -254,8 +271,16 @@ int GUI() {
         sound_system->createSound("Assets/privatesound.mp3", FMOD_LOOP_OFF, NULL, &private_sound);
 
         // Main loop
-        bool done = false;
+        u32  redraw_frames = REDRAW_FRAMES_AFTER_EVENT;
+        bool done          = false;
         while (!done) {
+                // ===== Sleep Until Something Happens =====
+                // NOTE: Returns as soon as a window message arrives. Timing out only draws one frame, for the heartbeat.
+                if (redraw_frames == 0) {
+                        ::MsgWaitForMultipleObjectsEx(0, nullptr, IDLE_WAKE_INTERVAL_MS, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+                        redraw_frames = 1;
+                }
+
                 // Poll and handle messages (inputs, window resize, etc.)
                 // See the WndProc() function below for our to dispatch events to the Win32 backend.
                 MSG msg;
@@ -263,15 +288,13 @@ int GUI() {
                         ::TranslateMessage(&msg);
                         ::DispatchMessage(&msg);
                         if (msg.message == WM_QUIT) done = true;
+                        redraw_frames = REDRAW_FRAMES_AFTER_EVENT;
                 }
                 if (done) break;
 
                 // Handle window screen locked
-                if ((g_SwapChainOccluded && g_pSwapChain->Present(0, DXGI_PRESENT_TEST) == DXGI_STATUS_OCCLUDED) || ::IsIconic(hwnd)) {
-                        ::Sleep(10);
-                        continue;
-                }
-                g_SwapChainOccluded = false;
+                bool occluded = (g_SwapChainOccluded && g_pSwapChain->Present(0, DXGI_PRESENT_TEST) == DXGI_STATUS_OCCLUDED) || ::IsIconic(hwnd);
+                if (!occluded) g_SwapChainOccluded = false;
 
                 // Start the Dear ImGui frame
                 ImGui_ImplDX12_NewFrame();
@@ -289,6 +312,14 @@ int GUI() {
                 // Rendering
                 ImGui::Render();
 
+                // ===== Nothing To Draw To =====
+                // NOTE: The frame still ran so the client keeps applying messages and heartbeating while minimised, only drawing is skipped.
+                // Then it sleeps until the next wake rather than polling.
+                if (occluded) {
+                        redraw_frames = 0;
+                        continue;
+                }
+
                 FrameContext* frameCtx      = WaitForNextFrameContext();
                 UINT          backBufferIdx = g_pSwapChain->GetCurrentBackBufferIndex();
                 frameCtx->CommandAllocator->Reset();
@@ -324,6 +355,7 @@ int GUI() {
                 // HRESULT hr = g_pSwapChain->Present(0, g_SwapChainTearingSupport ? DXGI_PRESENT_ALLOW_TEARING : 0); // Present without vsync
                 g_SwapChainOccluded = (hr == DXGI_STATUS_OCCLUDED);
                 g_frameIndex++;
+                redraw_frames--;
         }
 
         WaitForPendingOperations();
@@ -598,23 +630,120 @@ float GetTextHeight(const char* text, float wrap_width) {
         return single_line_height.y + (single_line_height.y) * (message_text_size.y / single_line_height.y);
 }
 
+// ===== Chat Log Layout =====
+// Only the messages on screen are laid out and drawn. Each messages wrapped height is measured once and kept in its HistoryEntry, the top of
+// every row is a running sum of them, so the first visible row is a binary search on the scroll position.
+// NOTE: Not ImGuiListClipper, it needs every row to be the same height and messages wrap to any number of lines.
+struct ChatLogLayout {
+        float              width{ -1.0f };   // Heights were measured for this width, all are measured again once it changes.
+        u64                total{};          // history.total, total_front and Count when row_tops was last updated.
+        u64                total_front{};
+        u32                count{};
+        u32                dirty_from{ ~0u }; // First row measured again since, eg. its senders name was looked up. Rows after it move.
+        u32                first{};          // Rows before it went with the messages the history dropped.
+        std::vector<float> row_tops;         // From first on, Count + 1 of them, the last is the bottom of the whole log.
+};
+
+static float RowTop(const ChatLogLayout& layout, u32 row) {
+        return layout.row_tops[layout.first + row] - layout.row_tops[layout.first];
+}
+
+// NOTE: Same colour for a user every frame without keeping one, taken from a hash of their ID.
+static ImVec4 UserColour(UserID user_id) {
+        u32 hash = user_id * 2'654'435'761u;
+        return ImVec4(0.5f + float((hash >> 8) & 0xff) / 510.0f, 0.5f + float((hash >> 16) & 0xff) / 510.0f, 0.5f + float(hash >> 24) / 510.0f, 1.0f);
+}
+
+static void MeasureChatRow(Client& client, HistoryEntry& entry, StringHandle user_name, float width) {
+        ImGuiStyle& style = ImGui::GetStyle();
+
+        entry.layout_name = user_name;
+
+        if (entry.sender == 0) {
+                entry.layout_height = ImGui::GetTextLineHeight() + style.SeparatorTextPadding.y * 2.0f + style.ItemSpacing.y;
+                return;
+        }
+
+        // NOTE: Same wrap width TextWrapped uses, from after the name to the right edge.
+        float name_width    = ImGui::CalcTextSize(client.names.CStr(user_name)).x;
+        float text_height   = ImGui::CalcTextSize(entry.content, nullptr, false, std::max(width - name_width - style.ItemSpacing.x, 1.0f)).y;
+        entry.layout_height = std::max(ImGui::GetTextLineHeight(), text_height) + style.ItemSpacing.y;
+}
+
+static void UpdateChatLogLayout(Client& client, ChatLogLayout& layout, MessageHistory& history, float width) {
+        u32 count    = history.Count();
+        u64 appended = history.total - layout.total;
+        u32 kept     = count - (u32)std::min(appended, (u64)count); // Rows from last time, the rest were pushed since.
+
+        // ===== Rebuild Row Tops =====
+        // NOTE: Only for a new width or older messages added in front, otherwise just the rows that changed are touched. Only messages that
+        // are new or were never measured at this width are measured, the rest just add up their cached height.
+        bool width_changed = layout.width != width;
+        if (width_changed or layout.total_front != history.total_front or kept > layout.count or layout.row_tops.empty()) {
+                layout.row_tops.assign(1, 0.0f);
+                layout.first = 0;
+                kept         = 0;
+        } else {
+                // ===== Forget Rows Whose Messages Were Dropped =====
+                u32 dropped        = layout.count - kept;
+                layout.first      += dropped;
+                layout.dirty_from  = layout.dirty_from > dropped ? layout.dirty_from - dropped : 0;
+
+                // ===== Move The Rows After One Measured Again =====
+                for (u32 i = layout.dirty_from; i < kept; i++) {
+                        layout.row_tops[layout.first + i + 1] = layout.row_tops[layout.first + i] + history.Get(i).layout_height;
+                }
+
+                layout.row_tops.resize(layout.first + kept + 1);
+        }
+
+        // ===== Add Rows For New Messages =====
+        for (u32 i = kept; i < count; i++) {
+                HistoryEntry& entry = history.Get(i);
+                if (width_changed or entry.layout_height == 0.0f) {
+                        StringHandle user_name = entry.sender == 0 ? 0 : client.users[entry.sender].user_name;
+                        MeasureChatRow(client, entry, user_name, width);
+                }
+
+                layout.row_tops.push_back(layout.row_tops.back() + entry.layout_height);
+        }
+
+        // ===== Let Go Of Dropped Rows =====
+        // NOTE: Only once they are half of row_tops so a full log stays O(1) per message, it also keeps the tops from growing forever.
+        if (layout.first > layout.row_tops.size() / 2) {
+                float base = layout.row_tops[layout.first];
+                layout.row_tops.erase(layout.row_tops.begin(), layout.row_tops.begin() + layout.first);
+                for (float& top : layout.row_tops) {
+                        top -= base;
+                }
+                layout.first = 0;
+        }
+
+        layout.width       = width;
+        layout.total       = history.total;
+        layout.total_front = history.total_front;
+        layout.count       = count;
+        layout.dirty_from  = ~0u;
+}
+
 void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMOD::Sound* private_sound) {
         // TODO: Check Server is still running, if not throw an error modal with a refresh button to allow checking.
 
         // Need to negate so we can use as a ptr to open popup.
-        static bool                                 not_logged_in     = true;
-        static bool                                 failed_to_connect = true;
-        static char                                 user_name[64]     = {};
-        static Client                               user_client{};
-        static ChannelID                            current_channel_id = ChannelIDGlobal;
-        static char                                 input_buffer[512]{};  // TODO: Store somewhere else.
-        static u32                                  last_message_count{}; // Used for checking if theres new messages
-        static bool                                 last_was_at_bottom{};
-        static std::unordered_map<UserID, float[3]> user_colours{};
-        static std::unordered_map<ChannelID, u32>   last_read_message{};
-        static std::unordered_map<ChannelID, u32>   last_notified_message{};
-
-        std::srand((u32)std::time(nullptr));
+        static bool                                         not_logged_in     = true;
+        static bool                                         failed_to_connect = true;
+        static char                                         user_name[64]     = {};
+        static Client                                       user_client{};
+        static ChannelID                                    current_channel_id = ChannelIDGlobal;
+        static char                                         input_buffer[512]{};  // TODO: Store somewhere else.
+        static u64                                          last_message_count{}; // Used for checking if theres new messages
+        static bool                                         last_was_at_bottom{};
+        static u32                                          last_history_count{}; // With last_message_count, tells older messages being added apart.
+        static ChannelID                                    last_history_channel_id{};
+        static float                                        scroll_anchor_max_y = -1.0f; // ScrollMaxY before older messages were added.
+        static std::unordered_map<ChannelID, ChatLogLayout> chat_log_layouts{};
+        static std::unordered_map<ChannelID, u64>           last_read_message{};
+        static std::unordered_map<ChannelID, u64>           last_notified_message{};
 
         const ImGuiViewport* viewport = ImGui::GetMainViewport();
 
@@ -637,6 +766,7 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
                 if (ImGui::IsKeyPressed(ImGuiKey_Enter) or ImGui::Button("Enter")) {
                         not_logged_in = false;
 
+                        user_client.on_network_event = WakeGUI;
                         if (user_client.Init() != ReturnCode::Success) {
                                 std::println("Server might be down!");
 
@@ -653,8 +783,17 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
 
 
         if (!failed_to_connect) {
+                // ===== Get Messages =====
+                // NOTE: Already received on the network thread, this only applies them. Done first so every window this frame sees them.
+                user_client.ProcessMessages();
+
                 // ===== Check Server Is Available =====
-                if (user_client.Ping() != ReturnCode::Success) failed_to_connect = true;
+                // NOTE: Doesnt send anything most frames, only once the link has been quiet for a while.
+                // NOTE: Can fail on the idle timer, which only draws one frame, so wake for the frames the popup needs.
+                if (user_client.Heartbeat() != ReturnCode::Success) {
+                        failed_to_connect = true;
+                        WakeGUI();
+                }
         }
 
         if (failed_to_connect) {
@@ -669,18 +808,20 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
                 ImGui::Text("Failed to connect to server. It Might be down.");
 
                 if (ImGui::Button("Retry")) {
+                        // Reset the channels, we can keep global messages but private channels are broken with server change.
+                        // NOTE: Before reconnecting, the hello tells the server what we still have. Globals users are kept, the server only
+                        // sends who changed.
+                        user_client.channel_count    = 1;
+                        user_client.chat_channels[0] = ChannelIDGlobal;
+                        Channel channel = std::move(user_client.channels[ChannelIDGlobal]); // Keep global
+                        user_client.channels.clear();
+                        user_client.channels[ChannelIDGlobal] = std::move(channel);
+
+                        current_channel_id = ChannelIDGlobal;
+
                         if (user_client.Reconnect() != ReturnCode::Success) {
                                 std::println("Server might be down!");
                         } else {
-                                // Reset the channels, we can keep global messages but private channels are broken with server change.
-                                user_client.channel_count = 1;
-                                Channel channel = user_client.channels[ChannelIDGlobal]; // Copy global
-                                user_client.channels.clear();
-                                user_client.channels[ChannelIDGlobal] = channel;
-                                user_client.channels[ChannelIDGlobal].user_count = 0;
-
-                                current_channel_id = ChannelIDGlobal;
-
                                 user_client.SendUserName(std::string(user_name));
                                 failed_to_connect = false;
                         }
@@ -695,8 +836,8 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
                 ChannelID channel_id = user_client.chat_channels[channel_idx];
                 Channel& channel = user_client.channels[channel_id];
 
-                if (channel.message_count > last_notified_message[channel_id]) {
-                        if (channel_id == current_channel_id and last_read_message[current_channel_id] == channel.message_count) {
+                if (channel.history.total > last_notified_message[channel_id]) {
+                        if (channel_id == current_channel_id and last_read_message[current_channel_id] == channel.history.total) {
                                 // ===== Dont Send Notification If We Are Looking At It =====
                         } else {
                                 if (channel_id == ChannelIDGlobal) sound_system->playSound(notification_sound, NULL, false, nullptr);
@@ -704,7 +845,7 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
                         }
                 }
 
-                last_notified_message[channel_id] = channel.message_count;
+                last_notified_message[channel_id] = channel.history.total;
         }
 
         // ===== Chat App =====
@@ -728,27 +869,25 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
 
                 ImGui::BeginGroup();
 
-                ImVec2 chat_channel_size{ min(ImGui::GetContentRegionAvail().x * 0.3f, 400), ImGui::GetContentRegionAvail().y };
+                ImVec2 chat_channel_size{ std::min(ImGui::GetContentRegionAvail().x * 0.3f, 400.0f), ImGui::GetContentRegionAvail().y };
 
                 ImGui::BeginChild("ChatChannels", chat_channel_size, child_flags);
                 {
                         ImGui::Text("Channels");
                         ImGui::Separator();
 
+                        // NOTE: A channels older messages are requested a page at a time, once its chat log is scrolled to the top.
                         // ===== TODO =====
-                        // On changeing channel, send request for how many messages in that channel.
-                        // If we have cached the same number we should be ok, maybe want to check most recent?
-                        // Otherwise we can reserve how many there should be and then request for the messages that we dont have.
                         // if we add message deletion this becomes a bit more difficult, unless we store some empty message for deleted messages.
                         // Can have like a server user which can print server messages.
 
                         for (u32 i = 0; i < user_client.channel_count; i++) {
                                 ChannelID chat_channel_id   = user_client.chat_channels[i];
-                                ImVec2    channel_text_size = ImGui::CalcTextSize(user_client.channels[chat_channel_id].name.c_str());
+                                ImVec2    channel_text_size = ImGui::CalcTextSize(user_client.names.CStr(user_client.channels[chat_channel_id].name));
 
                                 ImGui::PushID(i);
 
-                                float channel_height = GetTextHeight(user_client.channels[chat_channel_id].name.c_str(), ImGui::GetContentRegionAvail().x);
+                                float channel_height = GetTextHeight(user_client.names.CStr(user_client.channels[chat_channel_id].name), ImGui::GetContentRegionAvail().x);
 
                                 ImGui::BeginChild("##channels", ImVec2{ ImGui::GetContentRegionAvail().x, channel_height }, child_flags);
                                 if (ImGui::BeginPopupContextWindow()) {
@@ -777,13 +916,13 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
 
                                 ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.8f, 0.8f, 0.3f, 1.0f));
 
-                                std::string channel_text = user_client.channels[chat_channel_id].name;
+                                // NOTE: Formatted into a stack buffer, the name itself is never copied.
+                                bool unread = last_read_message[chat_channel_id] != user_client.channels[chat_channel_id].history.total;
 
-                                if (last_read_message[chat_channel_id] != user_client.channels[chat_channel_id].message_count) {
-                                        channel_text += "*";
-                                }
+                                char channel_text[message_buffer_length + 2];
+                                snprintf(channel_text, sizeof(channel_text), "%s%s", user_client.names.CStr(user_client.channels[chat_channel_id].name), unread ? "*" : "");
 
-                                if (ImGui::Selectable(channel_text.c_str(), current_channel_id == chat_channel_id)) {
+                                if (ImGui::Selectable(channel_text, current_channel_id == chat_channel_id)) {
                                         current_channel_id = chat_channel_id;
                                 }
 
@@ -809,7 +948,7 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
 
                         // ===== MESSAGES =====
 
-                        ImGui::Text(user_client.channels[current_channel_id].name.c_str());
+                        ImGui::TextUnformatted(user_client.names.CStr(user_client.channels[current_channel_id].name));
                         ImGui::Separator();
 
                         ImVec2 messages_size = ImGui::GetContentRegionAvail();
@@ -817,59 +956,70 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
 
                         // ImGui::SetNextWindowScroll(ImVec2{0, message_scroll_position});
 
-                        ImGui::BeginChild("Messages", messages_size, child_flags);
+                        // NOTE: Always showing the scrollbar keeps the width the same once the log gets long enough to scroll, see Chat Log Layout.
+                        ImGui::BeginChild("Messages", messages_size, child_flags, ImGuiWindowFlags_AlwaysVerticalScrollbar);
                         {
-                                // ===== Get Messages =====
-                                user_client.ProcessMessages();
-
-                                Message* messages      = user_client.channels[current_channel_id].messages;
-                                u32      message_count = user_client.channels[current_channel_id].message_count;
+                                MessageHistory& history       = user_client.channels[current_channel_id].history;
+                                u64             message_count = history.total;
+
+                                // NOTE: More messages kept than new ones arrived, so a page of older ones was added in front. The history can also
+                                // shrink, eg. cleared by a resync, which is never older messages.
+                                bool added_older = last_history_channel_id == current_channel_id and history.Count() > last_history_count and
+                                                   history.Count() - last_history_count > message_count - last_message_count;
+                                last_history_count      = history.Count();
+                                last_history_channel_id = current_channel_id;
+
+                                // ===== Draw Only The Visible Rows =====
+                                ChatLogLayout& layout = chat_log_layouts[current_channel_id];
+                                float          width  = ImGui::GetContentRegionAvail().x;
+                                UpdateChatLogLayout(user_client, layout, history, width);
+
+                                float log_top     = ImGui::GetCursorPosY();
+                                float visible_top = ImGui::GetScrollY() - log_top + layout.row_tops[layout.first];
+                                float visible_end = visible_top + ImGui::GetWindowHeight();
+                                auto  rows_begin  = layout.row_tops.begin() + layout.first;
+                                auto  rows_end    = rows_begin + history.Count();
+                                u32   first_row   = (u32)std::max(std::upper_bound(rows_begin, rows_end, visible_top) - rows_begin - 1, (ptrdiff_t)0);
+                                u32   end_row     = (u32)(std::lower_bound(rows_begin, rows_end, visible_end) - rows_begin);
+
+                                for (u32 i = first_row; i < end_row; i++) {
+                                        HistoryEntry& message = history.Get(i);
+
+                                        // NOTE: Each row is placed at its measured top, so a height that is off never pushes the rows below it.
+                                        ImGui::SetCursorPosY(log_top + RowTop(layout, i));
 
-                                for (u32 i = 0; i < message_count; i++) {
                                         // ===== Server Messages =====
-                                        if (messages[i].sender == 0) {
-                                                ImGui::SeparatorText(messages[i].content);
+                                        if (message.sender == 0) {
+                                                ImGui::SeparatorText(message.content);
                                                 continue;
                                         }
 
                                         // ===== Actual Messages ======
-                                        User& user = user_client.users[messages[i].sender];
-
-                                        ImVec2 user_text_size     = ImGui::CalcTextSize(user.user_name.c_str());
-                                        ImVec2 single_line_height = ImGui::CalcTextSize("Hello");
-                                        ImVec2 message_text_size =
-                                                ImGui::CalcTextSize(messages[i].content, NULL, false, ImGui::GetContentRegionAvail().x - user_text_size.x - 40);
-
-                                        ImGui::PushID(i);
+                                        User& user = user_client.users[message.sender];
 
-                                        float message_height = GetTextHeight(messages[i].content, ImGui::GetContentRegionAvail().x - user_text_size.x - 40);
-
-                                        ImGui::BeginChild("##messages", ImVec2{ ImGui::GetContentRegionAvail().x, message_height }, child_flags);
-
-                                        if (!user_colours.contains(user.id)) {
-                                                std::srand((u32)std::time(nullptr));
-                                                user_colours[user.id][0] = 0.5f + (float(std::rand() % 1'000) / 2'000);
-                                                user_colours[user.id][1] = 0.5f + (float(std::rand() % 1'000) / 2'000);
-                                                user_colours[user.id][2] = 0.5f + (float(std::rand() % 1'000) / 2'000);
+                                        // ===== Name Changed Since It Was Measured =====
+                                        if (message.layout_name != user.user_name) {
+                                                MeasureChatRow(user_client, message, user.user_name, width);
+                                                layout.dirty_from = std::min(layout.dirty_from, i);
                                         }
 
-                                        float* c = user_colours[user.id];
-
-                                        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(c[0], c[1], c[2], 1.0f));
-                                        ImGui::TextWrapped(user.user_name.c_str());
+                                        ImGui::PushStyleColor(ImGuiCol_Text, UserColour(message.sender));
+                                        ImGui::TextUnformatted(user_client.names.CStr(user.user_name));
                                         ImGui::PopStyleColor();
 
                                         ImGui::SameLine();
 
                                         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.8f, 1.0f, 0.8f, 1.0f));
-                                        ImGui::TextWrapped(messages[i].content);
+                                        ImGui::PushTextWrapPos(0.0f);
+                                        ImGui::TextUnformatted(message.content, message.content + message.content_length);
+                                        ImGui::PopTextWrapPos();
                                         ImGui::PopStyleColor();
-
-                                        ImGui::EndChild();
-
-                                        ImGui::PopID();
                                 }
 
+                                // ===== Keep The Whole Log Scrollable =====
+                                ImGui::SetCursorPosY(log_top + RowTop(layout, history.Count()));
+                                ImGui::Dummy(ImVec2{ 0.0f, 0.0f });
+
                                 // ===== SCROLLING BEHAVIOUR =====
                                 // Need to do this weird check as setting scroll position on the first frame doesnt work.
                                 // So we just skip a frame.
@@ -877,6 +1027,11 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
                                         message_scroll_position = -2.0f;
                                 } else if (message_scroll_position == -2.0f) {
                                         message_scroll_position = ImGui::GetScrollMaxY();
+                                } else if (scroll_anchor_max_y >= 0.0f) {
+                                        // ===== Keep The Same Messages On Screen Once Older Ones Are Added Above =====
+                                        // NOTE: Their height only shows up in ScrollMaxY the frame after they were added.
+                                        message_scroll_position = ImGui::GetScrollY() + ImGui::GetScrollMaxY() - scroll_anchor_max_y;
+                                        scroll_anchor_max_y     = -1.0f;
                                 } else {
                                         message_scroll_position = ImGui::GetScrollY();
                                         if (message_scroll_position == ImGui::GetScrollMaxY()) last_was_at_bottom = true;
@@ -899,6 +1054,10 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
                                         // ===== Set Messages Read as Up-To-Date =====
                                         last_read_message[current_channel_id] = message_count;
                                 }
+
+                                // ===== Load Older Messages Once Scrolled To The Top =====
+                                if (added_older) scroll_anchor_max_y = ImGui::GetScrollMaxY();
+                                else if (scroll_anchor_max_y < 0.0f and ImGui::GetScrollY() <= 0.0f) user_client.RequestOlderHistory(current_channel_id);
                         }
                         ImGui::EndChild();
 
@@ -953,35 +1112,21 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
 
                         Channel& channel = user_client.channels[current_channel_id];
 
-                        for (u32 i = 0; i < channel.user_count; i++) {
-                                UserID user_id = channel.users[i];
+                        for (u32 i = 0; i < channel.users.Count(); i++) {
+                                UserID user_id = channel.users.ids[i];
                                 User&  user    = user_client.users[user_id];
 
-                                if (user.user_name.empty()) {
+                                if (user.user_name == empty_string) {
                                         // ===== Request Name =====
-                                        Message message{};
-
-                                        message.channel = ChannelIDServer;
-
-                                        // ===== Set Type =====
-                                        ServerMessageType message_type = MessageUserNameRequest;
-                                        memcpy(&message.content[0], &message_type, sizeof(ServerMessageType));
-                                        message.content_length += sizeof(ServerMessageType);
-
-                                        // ===== Set ID to request =====
-                                        memcpy(&message.content[sizeof(ServerMessageType)], &user_id, sizeof(UserID));
-                                        message.content_length += sizeof(UserID);
-
-                                        // ===== Send Message =====
-                                        int send_flags = 0;
-                                        send(user_client.client_socket, (char*)&message, sizeof(Message), send_flags);
+                                        // NOTE: Only queued, every lookup from this list goes out together once it has been walked.
+                                        user_client.RequestUserName(user_id);
 
                                         // ===== Set to temp name so that we dont request multiple times.
-                                        user.user_name = "Looking Up...";
+                                        user.user_name = user_client.names.Intern("Looking Up...");
 
                                         continue;
                                 }
-                                float channel_height = GetTextHeight(user.user_name.c_str(), ImGui::GetContentRegionAvail().x);
+                                float channel_height = GetTextHeight(user_client.names.CStr(user.user_name), ImGui::GetContentRegionAvail().x);
 
                                 ImGui::PushID(i);
 
@@ -1006,10 +1151,9 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
                                                         if (channel_id == ChannelIDGlobal) continue;
                                                         Channel& channel = user_client.channels[channel_id];
 
-                                                        if (channel.user_count != 2) continue;
+                                                        if (channel.users.Count() != 2) continue;
 
-                                                        if ((channel.users[0] == user_client.id or channel.users[1] == user_client.id) and
-                                                            (channel.users[0] == user_id or channel.users[1] == user_id)) {
+                                                        if (channel.users.Contains(user_client.id) and channel.users.Contains(user_id)) {
                                                                 // ===== This is the private message channel between these two users =====
                                                                 // NOTE: If we add group chats this is no longer true.
                                                                 current_channel_id = channel_id;
@@ -1026,22 +1170,16 @@ void ChatAppGUI(FMOD::System* sound_system, FMOD::Sound* notification_sound, FMO
                                         ImGui::EndPopup();
                                 }
 
-                                if (!user_colours.contains(user_id)) {
-                                        user_colours[user_id][0] = 0.5f + (float(std::rand() % 1'000) / 2'000);
-                                        user_colours[user_id][1] = 0.5f + (float(std::rand() % 1'000) / 2'000);
-                                        user_colours[user_id][2] = 0.5f + (float(std::rand() % 1'000) / 2'000);
-                                }
-
-                                float* c = user_colours[user_id];
-
-                                ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(c[0], c[1], c[2], 1.0f));
-                                ImGui::Text(user.user_name.c_str());
+                                ImGui::PushStyleColor(ImGuiCol_Text, UserColour(user_id));
+                                ImGui::TextUnformatted(user_client.names.CStr(user.user_name));
                                 ImGui::PopStyleColor();
 
                                 ImGui::EndChild();
 
                                 ImGui::PopID();
                         }
+
+                        user_client.FlushNameLookups();
                 }
                 ImGui::EndChild();
 
@@ -0,0 +1,121 @@
+#include "ChatApp.h"
+#include "History.h"
+
+#include <algorithm>
+#include <bit>
+
+// ===== Slab Allocator =====
+static u32 SizeClass(u32 size) {
+        u32 block_size = std::max(std::bit_ceil(size), (u32)SLAB_MIN_BLOCK_SIZE);
+        return std::countr_zero(block_size) - std::countr_zero((u32)SLAB_MIN_BLOCK_SIZE);
+}
+
+static_assert(SLAB_MIN_BLOCK_SIZE << (SLAB_SIZE_CLASS_COUNT - 1) >= message_buffer_length + 1);
+static_assert(SLAB_FIRST_SIZE >= SLAB_MIN_BLOCK_SIZE << (SLAB_SIZE_CLASS_COUNT - 1));
+
+char* SlabAllocator::Allocate(u32 size) {
+        u32 size_class = SizeClass(size);
+        u32 block_size = SLAB_MIN_BLOCK_SIZE << size_class;
+
+        // ===== Reuse A Freed Block =====
+        if (char* block = free_lists[size_class]) {
+                memcpy(&free_lists[size_class], block, sizeof(char*));
+                return block;
+        }
+
+        // ===== Carve From The Newest Slab =====
+        if (slab_used + block_size > slab_size) {
+                slab_size = slab_size == 0 ? SLAB_FIRST_SIZE : std::min(slab_size * 2, (u32)SLAB_MAX_SIZE);
+                slabs.push_back(std::make_unique<char[]>(slab_size));
+                slab_used = 0;
+        }
+
+        // NOTE: Blocks are powers of two from the start of the slab, so every block stays aligned to its size.
+        char* block  = &slabs.back()[slab_used];
+        slab_used   += block_size;
+
+        return block;
+}
+
+void SlabAllocator::Free(char* block, u32 size) {
+        u32 size_class = SizeClass(size);
+
+        memcpy(block, &free_lists[size_class], sizeof(char*));
+        free_lists[size_class] = block;
+}
+
+// ===== Message History =====
+static void StoreEntry(SlabAllocator& slab, HistoryEntry& entry, const Message& message) {
+        // ===== Store Only The Bytes Used =====
+        entry.seq            = message.seq;
+        entry.sender         = message.sender;
+        entry.timestamp      = message.timestamp;
+        entry.content_length = std::min(message.content_length, (u32)message_buffer_length);
+        entry.content        = slab.Allocate(entry.content_length + 1);
+        entry.layout_name    = 0;
+        entry.layout_height  = 0.0f;
+
+        memcpy(entry.content, message.content, entry.content_length);
+        entry.content[entry.content_length] = 0;
+}
+
+// Doubles entries up to depth, oldest first so head lands right after the last message. False once already at depth.
+static bool GrowEntries(MessageHistory& history) {
+        u32 capacity = (u32)history.entries.size();
+        u32 depth    = std::max(history.depth, 1u);
+        if (capacity >= depth) return false;
+
+        std::vector<HistoryEntry> grown(std::min(std::max(capacity * 2, (u32)HISTORY_FIRST_CAPACITY), depth));
+        for (u32 idx = 0; idx < history.count; idx++) {
+                grown[idx] = history.Get(idx);
+        }
+
+        history.entries = std::move(grown);
+        history.head    = history.count % (u32)history.entries.size();
+
+        return true;
+}
+
+void MessageHistory::Push(const Message& message) {
+        if (count == entries.size()) GrowEntries(*this);
+
+        HistoryEntry& entry = entries[head];
+
+        // ===== Drop The Oldest =====
+        if (count == entries.size()) slab.Free(entry.content, entry.content_length + 1);
+        else count++;
+
+        StoreEntry(slab, entry, message);
+
+        head = (head + 1) % (u32)entries.size();
+        total++;
+}
+
+bool MessageHistory::PushFront(const Message& message) {
+        if (count == entries.size() and !GrowEntries(*this)) return false;
+
+        count++;
+        total_front++;
+        StoreEntry(slab, Get(0), message);
+
+        return true;
+}
+
+void MessageHistory::Clear() {
+        for (u32 idx = 0; idx < count; idx++) {
+                HistoryEntry& entry = Get(idx);
+                slab.Free(entry.content, entry.content_length + 1);
+        }
+
+        head  = 0;
+        count = 0;
+}
+
+u32 MessageHistory::Count() const {
+        return count;
+}
+
+HistoryEntry& MessageHistory::Get(u32 idx) {
+        u32 oldest = (head + (u32)entries.size() - count) % (u32)entries.size();
+        return entries[(oldest + idx) % (u32)entries.size()];
+}
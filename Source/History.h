@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Base.h"
+#include "ChatApp.h"
+
+#include <memory>
+#include <vector>
+
+// ===== Slab Allocator =====
+// Hands out blocks in power of two size classes, carved from large slabs and reused through per class free lists. A message only takes
+// the block its content fits in, instead of the full message_buffer_length.
+// NOTE: Slabs start small and double up to SLAB_MAX_SIZE, a quiet channel or DM only pays for the few messages it has.
+
+#define SLAB_FIRST_SIZE       (2 * 1'024)
+#define SLAB_MAX_SIZE         (64 * 1'024)
+#define SLAB_MIN_BLOCK_SIZE   16
+#define SLAB_SIZE_CLASS_COUNT 7 // 16 to 1024 bytes, enough for a full message plus its terminator.
+
+struct SlabAllocator {
+        char* Allocate(u32 size);
+        void  Free(char* block, u32 size);
+
+        std::vector<std::unique_ptr<char[]>> slabs;
+        u32                                  slab_size{}; // Size of the newest slab, 0 until the first one.
+        u32                                  slab_used{}; // Bytes handed out from the newest slab.
+
+        // NOTE: Free blocks store the next free block in their first bytes.
+        char* free_lists[SLAB_SIZE_CLASS_COUNT]{};
+};
+
+// ===== Message History =====
+#define DEFAULT_HISTORY_DEPTH  4'096
+#define HISTORY_FIRST_CAPACITY 16 // Entries allocated on the first Push, doubled as the history fills up to depth.
+
+// NOTE: The layout fields fill what would otherwise be padding, the server pays nothing for them.
+struct HistoryEntry {
+        u64       seq; // Message::seq, 0 if there isnt one.
+        UserID    sender;
+        u32       layout_name; // Client only, the senders name handle layout_height was measured with.
+        TimeStamp timestamp;
+        u32       content_length;
+        float     layout_height; // Client only, the wrapped height the GUI last measured, 0 if it hasnt. See Chat Log Layout.
+        char*     content;       // Null terminated, owned by the historys slab.
+};
+
+// The most recent depth messages of one channel, oldest first. Once full each new message replaces the oldest.
+struct MessageHistory {
+        void Push(const Message& message);
+        // Older than everything already kept, eg. scrollback fetched from the server. False once full, it never drops the newest.
+        // NOTE: Doesnt count towards total, it is not a new message.
+        bool PushFront(const Message& message);
+        void Clear();
+
+        u32           Count() const;
+        HistoryEntry& Get(u32 idx); // 0 is the oldest message still kept.
+
+        u32 depth{ DEFAULT_HISTORY_DEPTH }; // Only change before the first Push.
+        u64 total{};                        // Every message ever pushed, keeps counting once old ones are dropped.
+        u64 total_front{};                  // Every message PushFront added, so a view can tell older messages were added in front.
+
+        std::vector<HistoryEntry> entries; // Grows geometrically up to depth, see HISTORY_FIRST_CAPACITY.
+        u32                       head{};  // Where the next message goes.
+        u32                       count{};
+
+        SlabAllocator slab;
+};
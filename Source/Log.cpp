@@ -0,0 +1,423 @@
+#include "ChatApp.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+
+// ===== Records =====
+std::string LogSegmentPath(const std::string& directory, u64 index) {
+        char name[32];
+        snprintf(name, sizeof(name), "%010llu.log", (unsigned long long)index);
+
+        return (std::filesystem::path(directory) / name).string();
+}
+
+std::vector<u64> ListLogSegments(const std::string& directory) {
+        std::vector<u64> indices;
+
+        std::error_code error;
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error)) {
+                if (entry.path().extension() != ".log") continue;
+
+                indices.push_back(std::strtoull(entry.path().stem().string().c_str(), nullptr, 10));
+        }
+
+        std::sort(indices.begin(), indices.end());
+        return indices;
+}
+
+// FNV-1a, only has to catch torn writes, not tampering.
+u32 LogChecksum(const char* data, u32 length) {
+        u32 hash = 2'166'136'261u;
+        for (u32 i = 0; i < length; i++) {
+                hash ^= (u8)data[i];
+                hash *= 16'777'619u;
+        }
+
+        return hash;
+}
+
+static void EncodeRecord(const Message& message, std::vector<char>& out) {
+        size_t start = out.size();
+
+        // ===== Write Frame =====
+        // NOTE: Room for the biggest frame first, then trimmed to what it took.
+        out.resize(start + LOG_RECORD_HEADER_SIZE + max_frame_size);
+        u32 record_size = LOG_RECORD_HEADER_SIZE + EncodeFrame(message, FrameMessage, &out[start + LOG_RECORD_HEADER_SIZE]);
+        out.resize(start + record_size);
+
+        // ===== Write Header =====
+        char* record = &out[start];
+        memcpy(&record[0], &record_size, sizeof(u32));
+
+        u32 checksum = LogChecksum(&record[LOG_RECORD_HEADER_SIZE], record_size - LOG_RECORD_HEADER_SIZE);
+        memcpy(&record[4], &checksum, sizeof(u32));
+}
+
+// Only checks the record fits in what is left and its frame header is sane, not the checksum.
+static bool RecordFits(const char* record, size_t remaining, u32& record_size) {
+        if (remaining < LOG_RECORD_HEADER_SIZE + FRAME_HEADER_SIZE) return false;
+
+        memcpy(&record_size, &record[0], sizeof(u32));
+        if (record_size > remaining) return false;
+
+        return record_size == LOG_RECORD_HEADER_SIZE + FrameSize(&record[LOG_RECORD_HEADER_SIZE]);
+}
+
+static bool RecordChecksumValid(const char* record, u32 record_size) {
+        u32 checksum;
+        memcpy(&checksum, &record[4], sizeof(u32));
+
+        return checksum == LogChecksum(&record[LOG_RECORD_HEADER_SIZE], record_size - LOG_RECORD_HEADER_SIZE);
+}
+
+// ===== Message Log =====
+bool MessageLog::Init(const std::string& log_directory) {
+        directory = log_directory;
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+                std::println("Failed creating log directory {}: {}", directory, error.message());
+                return false;
+        }
+
+        // ===== Start After The Newest Segment =====
+        // NOTE: Never append to an old segment, its tail may be a torn record from a crash.
+        std::vector<u64> existing   = ListLogSegments(directory);
+        u64              next_index = existing.empty() ? 0 : existing.back() + 1;
+
+        if (!OpenSegment(next_index)) return false;
+
+        last_sync = std::chrono::steady_clock::now();
+        thread    = std::thread(&MessageLog::WriterLoop, this);
+
+        return true;
+}
+
+void MessageLog::Shutdown() {
+        if (!thread.joinable()) return;
+
+        {
+                std::lock_guard lock(mutex);
+                stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+
+        if (segment != nullptr) {
+                SyncFile(segment);
+                fclose(segment);
+        }
+        segment = nullptr;
+}
+
+void MessageLog::Append(const Message& message) {
+        bool was_empty;
+        {
+                std::lock_guard lock(mutex);
+                was_empty = pending.empty();
+
+                EncodeRecord(message, pending);
+        }
+
+        // NOTE: The writer is only asleep when there was nothing pending.
+        if (was_empty) wake.notify_one();
+}
+
+void MessageLog::AppendChannelRemoved(ChannelID channel) {
+        // NOTE: Forgotten now so a new channel with the ID cant read the old records, and again once the record is written, older records
+        // of the channel may still have been waiting for the writer.
+        {
+                std::lock_guard lock(index_mutex);
+                index.erase(channel);
+        }
+
+        Message removed{};
+        removed.channel = channel;
+        Append(removed);
+}
+
+void MessageLog::WriterLoop() {
+        std::vector<char> batch;
+
+        while (true) {
+                // ===== Take Everything Appended Since The Last Batch =====
+                bool stop;
+                {
+                        std::unique_lock lock(mutex);
+                        wake.wait_for(lock, std::chrono::milliseconds(sync_interval_ms), [&] { return stopping or !pending.empty(); });
+
+                        batch.swap(pending);
+                        stop = stopping;
+                }
+
+                if (!batch.empty()) WriteBatch(batch);
+                batch.clear();
+
+                // ===== Group Commit =====
+                bool sync_due = false;
+                switch (durability) {
+                case LogDurability::EveryMessage: {
+                        sync_due = true;
+                } break;
+                case LogDurability::Interval: {
+                        sync_due = std::chrono::steady_clock::now() - last_sync >= std::chrono::milliseconds(sync_interval_ms);
+                } break;
+                case LogDurability::OS: {
+                } break;
+                }
+
+                if (sync_due and unsynced) Sync();
+
+                if (stop) return;
+        }
+}
+
+void MessageLog::WriteBatch(const std::vector<char>& batch) {
+        // NOTE: Only after a segment failed to open, the messages are still in memory.
+        if (segment == nullptr) return;
+
+        size_t offset = 0;
+
+        while (offset < batch.size()) {
+                // ===== Take As Many Whole Records As Fit In This Segment =====
+                size_t end = offset;
+                while (end < batch.size()) {
+                        u32 record_size;
+                        memcpy(&record_size, &batch[end], sizeof(u32));
+
+                        bool segment_full = segment_bytes + (end - offset) + record_size > segment_size;
+                        if (segment_full and (end > offset or segment_bytes > 0)) break;
+
+                        end += record_size;
+                }
+
+                if (end == offset) {
+                        // ===== Roll To The Next Segment =====
+                        Sync();
+                        fclose(segment);
+                        segment = nullptr;
+
+                        if (!OpenSegment(segment_index + 1)) return;
+                        continue;
+                }
+
+                if (fwrite(&batch[offset], 1, end - offset, segment) != end - offset) {
+                        std::println("Failed writing to the message log");
+                        return;
+                }
+
+                // NOTE: Hand it to the OS now either way, so only a machine crash can lose it before the next sync. It also has to be
+                // in the file before it is indexed, readers map the file.
+                fflush(segment);
+
+                // ===== Index What Was Written =====
+                for (size_t record_offset = offset; record_offset < end;) {
+                        const char* record = &batch[record_offset];
+
+                        u32       record_size;
+                        ChannelID channel;
+                        u64       seq;
+                        memcpy(&record_size, &record[0], sizeof(u32));
+                        memcpy(&seq, &record[LOG_RECORD_SEQ], sizeof(u64));
+                        memcpy(&channel, &record[LOG_RECORD_CHANNEL], sizeof(ChannelID));
+
+                        IndexRecord(channel, seq, segment_index, segment_bytes + (record_offset - offset));
+                        record_offset += record_size;
+                }
+
+                segment_bytes += end - offset;
+                offset         = end;
+                unsynced       = true;
+        }
+}
+
+bool MessageLog::OpenSegment(u64 index) {
+        std::string path = LogSegmentPath(directory, index);
+
+        segment = fopen(path.c_str(), "wb");
+        if (segment == nullptr) {
+                std::println("Failed opening log segment {}", path);
+                return false;
+        }
+
+        segment_index = index;
+        segment_bytes = 0;
+
+        return true;
+}
+
+void MessageLog::Sync() {
+        if (segment != nullptr and !SyncFile(segment)) std::println("Failed syncing the message log");
+
+        unsynced  = false;
+        last_sync = std::chrono::steady_clock::now();
+}
+
+// ===== Log Reader =====
+bool LogReader::Open(const std::string& path) {
+        segment = MapLogSegment(path);
+        offset  = 0;
+
+        return segment != nullptr;
+}
+
+bool LogReader::Next(Message& message) {
+        const char* record = &segment->data[offset];
+
+        // ===== Check The Record Is Whole =====
+        u32 record_size;
+        if (!RecordFits(record, segment->size - offset, record_size)) return false;
+        if (!RecordChecksumValid(record, record_size)) return false;
+
+        FrameType type;
+        DecodeFrame(&record[LOG_RECORD_HEADER_SIZE], type, message);
+
+        offset += record_size;
+        return true;
+}
+
+// ===== Reading Back =====
+MappedSegment::~MappedSegment() {
+        if (data != nullptr) UnmapFile(data, size);
+}
+
+std::shared_ptr<const MappedSegment> MapLogSegment(const std::string& path) {
+        std::shared_ptr<MappedSegment> segment = std::make_shared<MappedSegment>();
+        segment->data                          = MapFileReadOnly(path.c_str(), segment->size);
+        if (segment->data == nullptr) return nullptr;
+
+        return segment;
+}
+
+void MessageLog::IndexRecord(ChannelID channel, u64 seq, u64 segment, u64 offset) {
+        std::lock_guard lock(index_mutex);
+
+        // ===== Channel Removed =====
+        if (seq == 0) {
+                index.erase(channel);
+                return;
+        }
+
+        // NOTE: Always index a channels first record, its earlier messages may never have made it to the log.
+        std::vector<LogIndexEntry>& entries = index[channel];
+        if (!entries.empty() and seq <= entries.back().seq) return;
+
+        // ===== Move The Tail Along =====
+        // NOTE: The last entry is always the channels newest record. It only stays once it is on the stride or the first one.
+        bool tail_pinned = entries.size() <= 1 or (entries.back().seq - 1) % LOG_INDEX_STRIDE == 0;
+        if (tail_pinned) entries.push_back({ seq, segment, offset });
+        else entries.back() = { seq, segment, offset };
+}
+
+std::shared_ptr<const MappedSegment> MessageLog::MapSegment(u64 index) {
+        std::string path = LogSegmentPath(directory, index);
+
+        std::lock_guard lock(index_mutex);
+
+        // ===== Reuse The Mapping Unless The Segment Has Grown Since =====
+        // NOTE: Only the segment being written grows. The map doesnt keep a mapping alive, once the last frame in it is sent it is unmapped
+        // and mapped again by the next read that needs it, so a long log never stays mapped as a whole.
+        auto mapped_it = mapped_segments.find(index);
+        if (mapped_it != mapped_segments.end()) {
+                std::shared_ptr<const MappedSegment> mapped = mapped_it->second.lock();
+                if (mapped != nullptr) {
+                        if (index != segment_index.load()) return mapped;
+
+                        std::error_code error;
+                        if (std::filesystem::file_size(path, error) <= mapped->size) return mapped;
+                }
+        }
+
+        std::shared_ptr<const MappedSegment> mapped = MapLogSegment(path);
+        if (mapped == nullptr) return nullptr;
+
+        // ===== Forget Mappings That Are Gone =====
+        std::erase_if(mapped_segments, [](const auto& entry) { return entry.second.expired(); });
+        mapped_segments[index] = mapped;
+
+        return mapped;
+}
+
+u32 MessageLog::ReadFrames(ChannelID channel, u64 first_seq, u32 max_count, std::vector<SharedFrame>& frames) {
+        if (max_count == 0) return 0;
+
+        // ===== Find Where To Start And Stop Scanning =====
+        // NOTE: Nothing past the channels newest record can be for it, so the scan never walks the rest of the log.
+        LogIndexEntry start;
+        LogIndexEntry tail;
+        {
+                std::lock_guard lock(index_mutex);
+
+                auto entries_it = index.find(channel);
+                if (entries_it == index.end()) return 0;
+
+                // NOTE: The last entry at or before first_seq, or the first entry if first_seq is older than anything logged.
+                std::vector<LogIndexEntry>& entries = entries_it->second;
+                auto entry_it = std::upper_bound(entries.begin(), entries.end(), first_seq, [](u64 seq, const LogIndexEntry& entry) {
+                        return seq < entry.seq;
+                });
+                start = entry_it == entries.begin() ? entries.front() : *(entry_it - 1);
+                tail  = entries.back();
+        }
+
+        if (first_seq > tail.seq) return 0;
+        u64 end_seq = first_seq + max_count;
+
+        // ===== Collect The Frames In Place =====
+        // NOTE: Every frame shares one allocation, which also holds the mappings they point into.
+        struct MappedFrames {
+                std::vector<std::shared_ptr<const MappedSegment>> segments;
+                std::vector<EncodedFrame>                         frames;
+        };
+        std::shared_ptr<MappedFrames> mapped = std::make_shared<MappedFrames>();
+
+        u64  next_seq = 0;
+        bool done     = false;
+        for (u64 index = start.segment; index <= tail.segment and !done; index++) {
+                std::shared_ptr<const MappedSegment> segment = MapSegment(index);
+                if (segment == nullptr) continue;
+
+                bool used   = false;
+                u64  offset = index == start.segment ? start.offset : 0;
+                while (!done) {
+                        if (index == tail.segment and offset > tail.offset) break;
+
+                        // NOTE: A torn record is the end of what was written to the segment.
+                        const char* record = &segment->data[offset];
+                        u32         record_size;
+                        if (!RecordFits(record, segment->size - offset, record_size)) break;
+
+                        ChannelID record_channel;
+                        u64       seq;
+                        memcpy(&record_channel, &record[LOG_RECORD_CHANNEL], sizeof(ChannelID));
+                        memcpy(&seq, &record[LOG_RECORD_SEQ], sizeof(u64));
+
+                        offset += record_size;
+                        if (record_channel != channel or seq < first_seq) continue;
+
+                        // NOTE: Only hand out consecutive messages, a gap means some never made it to the log.
+                        done = seq >= end_seq or (next_seq != 0 and seq != next_seq) or !RecordChecksumValid(record, record_size);
+                        if (done) break;
+
+                        EncodedFrame& frame = mapped->frames.emplace_back();
+                        frame.data          = &record[LOG_RECORD_HEADER_SIZE];
+                        frame.size          = record_size - LOG_RECORD_HEADER_SIZE;
+
+                        next_seq = seq + 1;
+                        used     = true;
+                        done     = mapped->frames.size() == max_count;
+                }
+
+                if (used) mapped->segments.push_back(std::move(segment));
+        }
+
+        // ===== Hand Out Frames That Share The Allocation =====
+        for (EncodedFrame& frame : mapped->frames) {
+                frames.push_back(SharedFrame(mapped, &frame));
+        }
+
+        return (u32)mapped->frames.size();
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Base.h"
+#include "ChatApp.h"
+#include "Message.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// ===== Message Log =====
+// Every chat message the server accepts is appended to a log on disk, split into numbered segment files of about segment_size bytes.
+// A record never spans two segments.
+// | record_size: u32 | checksum: u32 | frame... |
+// record_size is the whole record. The checksum covers everything after it, so a record torn by a crash can be told apart on replay.
+// The frame is the message exactly as it goes out on the wire, seq included, so history can be sent to clients straight out of the mapped
+// segment without decoding or copying it. seq counts up from 1 per channel.
+// A record with seq 0 and no content marks its channel removed. Custom channel IDs are reused, so everything logged for the ID before it
+// belonged to another channel and is never read back for the new one.
+
+#define LOG_RECORD_HEADER_SIZE 8
+#define LOG_RECORD_CHANNEL     (LOG_RECORD_HEADER_SIZE + 8)                // Where the frames channel is in the record.
+#define LOG_RECORD_SEQ         (LOG_RECORD_HEADER_SIZE + FRAME_SEQ_OFFSET) // And its seq.
+#define LOG_SEGMENT_SIZE       (64 * 1'024 * 1'024)
+#define LOG_SYNC_INTERVAL_MS   100
+
+// ===== Log Index =====
+// Sparse, one entry per LOG_INDEX_STRIDE messages of a channel, so finding a message is a binary search then a short scan of the segment.
+// The last entry is always the channels newest record, so a scan knows where the channel ends instead of reading to the end of the log.
+
+#define LOG_INDEX_STRIDE 64
+
+struct LogIndexEntry {
+        u64 seq;
+        u64 segment;
+        u64 offset; // Of the record in the segment.
+};
+
+// A segment mapped read only. Unmapped once nothing is using it, queued frames keep it alive until they are sent.
+struct MappedSegment {
+        MappedSegment() = default;
+        MappedSegment(const MappedSegment&) = delete;
+        ~MappedSegment();
+
+        const char* data{};
+        size_t      size{};
+};
+
+enum class LogDurability {
+        EveryMessage, // Every batch is fsynced before the next is taken. Messages that arrive together share one fsync, group commit.
+        Interval,     // fsync at most every sync_interval_ms, a crash loses at most that much.
+        OS,           // Never fsync, the OS writes the pages back whenever it likes.
+};
+
+// Writes on its own thread, appending only copies the record into a buffer so it never waits on the disk.
+struct MessageLog {
+        // Starts a new segment after any already in the directory. Returns false if the directory or segment couldnt be created.
+        bool Init(const std::string& log_directory);
+        // Writes and syncs everything appended so far.
+        void Shutdown();
+
+        // Safe to call from any thread. Records appended from one thread are written in that order.
+        void Append(const Message& message);
+        // Appends the record that marks the channel removed and forgets its index. Nothing of the channel may be appended after it.
+        void AppendChannelRemoved(ChannelID channel);
+
+        // Queues frames for the channels messages from first_seq on, at most max_count, read straight out of the mapped segments.
+        // Returns the number queued, they are consecutive from the first one and all before first_seq + max_count.
+        // NOTE: Only what the writer has written so far, the newest few messages may still be waiting for it.
+        u32 ReadFrames(ChannelID channel, u64 first_seq, u32 max_count, std::vector<SharedFrame>& frames);
+
+        // Makes the record the channels tail and keeps it if it is on the stride, a removal record forgets the channel instead. Records have
+        // to be indexed in the order they are in the log.
+        void IndexRecord(ChannelID channel, u64 seq, u64 segment, u64 offset);
+
+        std::shared_ptr<const MappedSegment> MapSegment(u64 index);
+
+        void WriterLoop();
+        void WriteBatch(const std::vector<char>& batch);
+        bool OpenSegment(u64 index);
+        void Sync();
+
+        LogDurability durability{ LogDurability::Interval };
+        u32           sync_interval_ms{ LOG_SYNC_INTERVAL_MS };
+        u64           segment_size{ LOG_SEGMENT_SIZE };
+
+        std::string directory;
+
+        // ===== Shared With Appending Threads =====
+        std::mutex              mutex;
+        std::condition_variable wake;
+        std::vector<char>       pending; // Encoded records waiting for the writer.
+        bool                    stopping{};
+
+        // ===== Index =====
+        // NOTE: Only held to look up or add entries and mappings, never while a segment is scanned.
+        std::mutex                                                  index_mutex;
+        std::unordered_map<ChannelID, std::vector<LogIndexEntry>>   index;
+        std::unordered_map<u64, std::weak_ptr<const MappedSegment>> mapped_segments; // Only while queued frames hold them, see MapSegment.
+
+        // ===== Writer Thread Only =====
+        std::thread                           thread;
+        FILE*                                 segment{};
+        std::atomic<u64>                      segment_index{}; // Also read by snapshots, see Server::CaptureSnapshot.
+        u64                                   segment_bytes{};
+        bool                                  unsynced{}; // Written since the last fsync.
+        std::chrono::steady_clock::time_point last_sync;
+};
+
+// Reads back the records of one segment in the order they were written.
+struct LogReader {
+        bool Open(const std::string& path);
+        // False at the end of the segment, or at the first record that is torn or fails its checksum. Nothing after it is trusted.
+        bool Next(Message& message);
+
+        std::shared_ptr<const MappedSegment> segment;
+        u64                                  offset{}; // Of the next record.
+};
+
+std::string                          LogSegmentPath(const std::string& directory, u64 index);
+std::vector<u64>                     ListLogSegments(const std::string& directory); // Oldest first.
+std::shared_ptr<const MappedSegment> MapLogSegment(const std::string& path);        // nullptr if it is missing or empty.
+u32                                  LogChecksum(const char* data, u32 length);
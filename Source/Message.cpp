@@ -0,0 +1,275 @@
+#include "ChatApp.h"
+#include "Message.h"
+
+#include <algorithm>
+#include <chrono>
+
+u32 EncodeFrame(const Message& message, FrameType type, char* buffer) {
+        u16 content_length = (u16)message.content_length;
+        u8  reserved       = 0;
+
+        // ===== Write Header =====
+        memcpy(&buffer[0], &content_length, sizeof(u16));
+        memcpy(&buffer[2], &type, sizeof(u8));
+        memcpy(&buffer[3], &reserved, sizeof(u8));
+        memcpy(&buffer[4], &message.sender, sizeof(UserID));
+        memcpy(&buffer[8], &message.channel, sizeof(ChannelID));
+        memcpy(&buffer[12], &message.timestamp, sizeof(TimeStamp));
+        memcpy(&buffer[FRAME_SEQ_OFFSET], &message.seq, sizeof(u64));
+
+        // ===== Write Content =====
+        memcpy(&buffer[FRAME_HEADER_SIZE], message.content, content_length);
+
+        return FRAME_HEADER_SIZE + content_length;
+}
+
+u32 FrameSize(const char* header) {
+        u16 content_length;
+        memcpy(&content_length, &header[0], sizeof(u16));
+
+        if (content_length > message_buffer_length) return 0;
+
+        return FRAME_HEADER_SIZE + content_length;
+}
+
+bool DecodeFrame(const char* buffer, FrameType& type, Message& message) {
+        u32 frame_size = FrameSize(buffer);
+        if (frame_size == 0) return false;
+
+        // ===== Read Header =====
+        message.content_length = frame_size - FRAME_HEADER_SIZE;
+        memcpy(&type, &buffer[2], sizeof(u8));
+        memcpy(&message.sender, &buffer[4], sizeof(UserID));
+        memcpy(&message.channel, &buffer[8], sizeof(ChannelID));
+        memcpy(&message.timestamp, &buffer[12], sizeof(TimeStamp));
+        memcpy(&message.seq, &buffer[FRAME_SEQ_OFFSET], sizeof(u64));
+
+        // ===== Read Content =====
+        memcpy(message.content, &buffer[FRAME_HEADER_SIZE], message.content_length);
+
+        // NOTE: Content is displayed as a c string in places, terminate it if theres room.
+        if (message.content_length < message_buffer_length) message.content[message.content_length] = 0;
+
+        return true;
+}
+
+int SendFrame(SOCKET socket, const Message& message, FrameType type) {
+        char buffer[max_frame_size];
+        u32  frame_size = EncodeFrame(message, type, buffer);
+
+        int send_flags = 0;
+        return send(socket, buffer, (int)frame_size, send_flags);
+}
+
+u64 MonotonicMs() {
+        return (u64)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Message HelloMessage() {
+        Message message{};
+        message.content[0]     = (char)protocol_version;
+        message.content_length = 1;
+
+        return message;
+}
+
+Message ResyncHello(u64 server_epoch, const ResyncChannel* channels, u32 channel_count) {
+        Message message = HelloMessage();
+        if (server_epoch == 0 or channel_count == 0) return message;
+
+        u16 count = (u16)std::min(channel_count, (u32)MAX_RESYNC_CHANNELS);
+        memcpy(&message.content[1], &server_epoch, sizeof(u64));
+        memcpy(&message.content[9], &count, sizeof(u16));
+        message.content_length = RESYNC_HELLO_SIZE;
+
+        for (u32 channel_idx = 0; channel_idx < count; channel_idx++) {
+                char* channel = &message.content[message.content_length];
+                memcpy(&channel[0], &channels[channel_idx].id, sizeof(ChannelID));
+                memcpy(&channel[4], &channels[channel_idx].last_seq, sizeof(u64));
+                memcpy(&channel[12], &channels[channel_idx].members_version, sizeof(u64));
+                message.content_length += RESYNC_CHANNEL_SIZE;
+        }
+
+        return message;
+}
+
+u32 ReadResyncHello(const Message& hello, u64& server_epoch, ResyncChannel* channels) {
+        server_epoch = 0;
+        if (hello.content_length < RESYNC_HELLO_SIZE) return 0;
+
+        u16 count;
+        memcpy(&server_epoch, &hello.content[1], sizeof(u64));
+        memcpy(&count, &hello.content[9], sizeof(u16));
+
+        // NOTE: Never trust the count, only read channels that are actually there.
+        u32 channel_count = std::min({ (u32)count, (u32)MAX_RESYNC_CHANNELS, (hello.content_length - RESYNC_HELLO_SIZE) / RESYNC_CHANNEL_SIZE });
+
+        for (u32 channel_idx = 0; channel_idx < channel_count; channel_idx++) {
+                const char* channel = &hello.content[RESYNC_HELLO_SIZE + channel_idx * RESYNC_CHANNEL_SIZE];
+                memcpy(&channels[channel_idx].id, &channel[0], sizeof(ChannelID));
+                memcpy(&channels[channel_idx].last_seq, &channel[4], sizeof(u64));
+                memcpy(&channels[channel_idx].members_version, &channel[12], sizeof(u64));
+        }
+
+        return channel_count;
+}
+
+int SendHello(SOCKET socket) {
+        return SendFrame(socket, HelloMessage(), FrameHello);
+}
+
+// ===== Receive Ring =====
+static_assert((RECV_RING_SIZE & (RECV_RING_SIZE - 1)) == 0, "RECV_RING_SIZE must be a power of two");
+static_assert(RECV_RING_SIZE > max_frame_size);
+
+u32 RecvRing::Used() {
+        return write_pos - read_pos;
+}
+
+char* RecvRing::WriteSpan(u32& length) {
+        u32 write_index = write_pos & (RECV_RING_SIZE - 1);
+        u32 free_space  = RECV_RING_SIZE - Used();
+
+        // NOTE: Only up to the end of the ring, the rest of the free space is filled by the next read.
+        length = std::min(free_space, RECV_RING_SIZE - write_index);
+        return &data[write_index];
+}
+
+void RecvRing::Commit(u32 length) {
+        write_pos += length;
+}
+
+int RecvRing::Fill(SOCKET socket) {
+        u32   length;
+        char* span = WriteSpan(length);
+
+        // NOTE: Frames are always drained after a fill, so at most a partial frame is left and there is always space.
+        int recieve_flags = 0;
+        int res           = recv(socket, span, (int)length, recieve_flags);
+        if (res > 0) Commit((u32)res);
+
+        return res;
+}
+
+const char* RecvRing::NextFrame(u32& frame_size, bool& invalid) {
+        invalid = false;
+
+        u32 used = Used();
+        if (used < FRAME_HEADER_SIZE) return nullptr;
+
+        u32   read_index = read_pos & (RECV_RING_SIZE - 1);
+        char* frame      = &data[read_index];
+
+        // ===== Mirror The Wrapped Part Past The End =====
+        u32 contiguous = RECV_RING_SIZE - read_index;
+        if (contiguous < FRAME_HEADER_SIZE) memcpy(&data[RECV_RING_SIZE], &data[0], FRAME_HEADER_SIZE - contiguous);
+
+        frame_size = FrameSize(frame);
+        if (frame_size == 0) {
+                invalid = true;
+                return nullptr;
+        }
+
+        if (used < frame_size) return nullptr;
+
+        if (contiguous < frame_size) memcpy(&data[RECV_RING_SIZE], &data[0], frame_size - contiguous);
+
+        return frame;
+}
+
+void RecvRing::Consume(u32 length) {
+        read_pos += length;
+}
+
+// ===== Send Queue =====
+SharedFrame MakeSharedFrame(const Message& message, FrameType type, OverflowPolicy policy, u64 coalesce_key) {
+        std::shared_ptr<BufferedFrame> frame = std::make_shared<BufferedFrame>();
+        frame->size                          = EncodeFrame(message, type, frame->buffer);
+        frame->data                          = frame->buffer;
+        frame->policy                       = policy;
+        frame->coalesce_key                 = coalesce_key;
+
+        return frame;
+}
+
+PushResult SendQueue::Push(SharedFrame frame, u32 in_flight) {
+        if (queued_bytes + frame->size > SEND_QUEUE_HIGH_WATER) {
+                switch (frame->policy) {
+                case OverflowPolicy::Disconnect: {
+                        return PushResult::Overflowed;
+                } break;
+                case OverflowPolicy::Drop: {
+                        return PushResult::Dropped;
+                } break;
+                case OverflowPolicy::Coalesce: {
+                        // ===== Replace An Older Frame With The Same Key =====
+                        // NOTE: A partly sent front frame cant be swapped out either.
+                        size_t first = std::max((size_t)in_flight, (size_t)(offset > 0 ? 1 : 0));
+                        for (size_t i = first; i < frames.size(); i++) {
+                                if (frames[i]->coalesce_key != frame->coalesce_key) continue;
+
+                                queued_bytes = queued_bytes - frames[i]->size + frame->size;
+                                frames[i]    = std::move(frame);
+                                return PushResult::Coalesced;
+                        }
+
+                        // NOTE: Nothing to replace, so it still has to go out, but only up to the hard limit.
+                        if (queued_bytes + frame->size > SEND_QUEUE_HARD_LIMIT) return PushResult::Overflowed;
+                } break;
+                }
+        }
+
+        queued_bytes += frame->size;
+        frames.push_back(std::move(frame));
+
+        return PushResult::Queued;
+}
+
+void SendQueue::Consume(u32 bytes_sent) {
+        queued_bytes -= bytes_sent;
+
+        while (bytes_sent > 0) {
+                u32 remaining = frames.front()->size - offset;
+                if (bytes_sent < remaining) {
+                        offset += bytes_sent;
+                        return;
+                }
+
+                bytes_sent -= remaining;
+                offset      = 0;
+                frames.pop_front();
+        }
+}
+
+void SendQueue::Truncate(u32 keep) {
+        while (frames.size() > keep) {
+                queued_bytes -= frames.back()->size;
+                frames.pop_back();
+        }
+
+        // NOTE: Only the front frame can be partly sent.
+        if (frames.empty()) {
+                queued_bytes = 0;
+                offset       = 0;
+        }
+}
+
+bool SendQueue::Flush(SOCKET socket) {
+        IoBuffer buffers[MAX_SEND_BATCH];
+
+        while (!frames.empty()) {
+                // ===== Gather =====
+                u32 buffer_count = (u32)std::min(frames.size(), (size_t)MAX_SEND_BATCH);
+                for (u32 i = 0; i < buffer_count; i++) {
+                        u32 start = i == 0 ? offset : 0;
+                        SetIoBuffer(buffers[i], (char*)frames[i]->data + start, frames[i]->size - start);
+                }
+
+                int res = SendVectored(socket, buffers, buffer_count);
+                if (res == SOCKET_ERROR) return SocketWouldBlock(); // Socket buffer is full, the rest goes once it is writable.
+
+                Consume((u32)res);
+        }
+
+        return true;
+}
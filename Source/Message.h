@@ -1,7 +1,11 @@
 #pragma once
 
+#include "Base.h"
 #include "ChatApp.h"
 
+#include <deque>
+#include <memory>
+
 enum ServerMessageType : u32 {
         MessageNone,
 
@@ -19,14 +23,217 @@ enum ServerMessageType : u32 {
         MessageCreateChannel,
         MessageUserInvite, // Not really an invite, as your forced into the channel.
 
+        MessageHistoryRequest,
+        MessageHistoryPage,
+
+        MessageUserListDiff,
+
+        MessagePong,
+
+        MessageUserNamesRequest,
+        MessageUserNamesSend,
 };
 
 struct Message {
         UserID    sender;                         // Set by server
         ChannelID channel;                        // Set by client
         TimeStamp timestamp;                      // Set by client
+        u64       seq;                            // Set by server, the channels sequence number for chat messages, 0 otherwise.
         u32       content_length;                 // Set by client
         char      content[message_buffer_length]; // Set by client
 };
 
-constexpr u32 message_size_in_bytes = sizeof(Message);
\ No newline at end of file
+// ===== History Pages =====
+// A client asks for a channels messages before or after a seq cursor, and gets them back a page at a time.
+// Request: | type: u32 | channel: u32 | cursor: u64 | direction: u8 | limit: u16 |
+// A cursor of 0 with HistoryBefore means from the newest message.
+// Page:    | type: u32 | channel: u32 | first_seq: u64 | count: u32 | direction: u8 | has_more: u8 |
+// The page is followed by exactly count chat frames for the channel, oldest first with consecutive seqs from first_seq. Nothing else is
+// sent to the client in between, so the client knows which frames belong to the page.
+
+#define MAX_HISTORY_PAGE 256 // Messages per page, keeps a page of full size messages under SEND_QUEUE_HIGH_WATER.
+
+enum HistoryDirection : u8 {
+        HistoryBefore, // Older than the cursor, for scrollback.
+        HistoryAfter,  // Newer than the cursor, to catch up.
+};
+
+// ===== Resync =====
+// A reconnecting client says what it already has in its hello, and the server only sends what it missed instead of everything again.
+// Server hello: | version: u8 | server_epoch: u64 |
+// Client hello: | version: u8 | server_epoch: u64 | channel_count: u16 | channel: | id: u32 | last_seq: u64 | members_version: u64 |... |
+// server_epoch is the one from the last servers hello, 0 on the first connect. A hello with no channels gets everything.
+// For each channel the server sends a MessageHistoryPage with what came after last_seq, at most one page. If more than a page was missed
+// the page is the newest one, and first_seq is past last_seq + 1 so the client knows there is a gap.
+// Diff:    | type: u32 | flags: u8 | added_count: u16 | added: u32... | removed: u32... |
+// Member lists are sent as one or more MessageUserListSync or MessageUserListDiff messages. The last one has the channels
+// members_version as its frame seq, the others have 0. The version is only comparable while server_epoch stays the same.
+
+#define MAX_RESYNC_CHANNELS 25 // As many as fit in one hello.
+#define RESYNC_HELLO_SIZE   11
+#define RESYNC_CHANNEL_SIZE 20
+
+enum MemberDiffFlags : u8 {
+        MemberDiffReset = 1 << 0, // The changes didnt go back far enough, clear the channels members. Everyone is in added.
+};
+
+struct ResyncChannel {
+        ChannelID id;
+        u64       last_seq;
+        u64       members_version;
+};
+
+// ===== Heartbeat =====
+// A client only pings when the link has gone quiet, nothing sent or nothing received for a heartbeat interval, so a busy connection never
+// pings at all. The server answers with a MessagePong with the same sent_ms, which gives the client its round trip time.
+// Ping / Pong: | type: u32 | sent_ms: u64 |   sent_ms is the clients MonotonicMs, only the client reads it.
+// A ping without sent_ms, from a version 2 client, isnt answered.
+// The server drops a connection it hasnt heard anything from for its idle timeout, and a client gives up on a server the same way.
+
+#define HEARTBEAT_INTERVAL_MS  5'000
+#define HEARTBEAT_MISS_LIMIT   3 // Intervals without hearing anything before giving up on the other side.
+#define IDLE_TIMEOUT_MS        (HEARTBEAT_MISS_LIMIT * HEARTBEAT_INTERVAL_MS)
+#define IDLE_CHECK_INTERVAL_MS 1'000 // How often a shard looks for idle connections.
+
+// ===== Name Lookups =====
+// A client asks for the names of many users in one message, and gets them back packed into as few messages as they fit in.
+// Request: | type: u32 | count: u16 | user_id: u32... |
+// Names:   | type: u32 | count: u16 | user: | id: u32 | name_length: u16 | name... |... |
+// Every ID asked for is answered once. An ID the server doesnt know, eg. the user has left, gets an empty name.
+// A version 3 server only knows MessageUserNameRequest, one ID per message, the client falls back to that.
+
+#define MAX_NAME_LOOKUPS        126 // IDs per request, as many as fit in one message.
+#define NAME_LOOKUP_HEADER_SIZE 6
+#define NAME_LOOKUP_ENTRY_SIZE  6 // Before the name.
+
+// Milliseconds on a clock that never goes backwards, only meaningful relative to another call on the same machine.
+u64 MonotonicMs();
+
+constexpr u32 message_size_in_bytes = sizeof(Message);
+
+// ===== Wire Format =====
+// Messages are not sent as the whole struct, only a compact header followed by content_length bytes of content.
+// | content_length: u16 | type: u8 | reserved: u8 | sender: u32 | channel: u32 | timestamp: u64 | seq: u64 | content... |
+// A ping is 40 bytes on the wire (the header and a 12 byte payload) instead of sizeof(Message).
+
+#define FRAME_HEADER_SIZE 28
+#define FRAME_SEQ_OFFSET  20
+
+constexpr u32 max_frame_size = FRAME_HEADER_SIZE + message_buffer_length;
+
+// Both sides send a FrameHello with their version as the very first frame and then talk the lower of the two versions.
+// Anything older than min_protocol_version is disconnected.
+// Version 2 added seq to the header. Version 3 added resync, a version 2 hello is treated as a first connect.
+// Version 4 added batched name lookups.
+constexpr u8 protocol_version     = 4;
+constexpr u8 min_protocol_version = 2;
+
+enum FrameType : u8 {
+        FrameMessage,
+        FrameHello, // content[0] is the senders protocol version.
+};
+
+// Writes the frame into buffer, which must hold max_frame_size bytes. Returns the number of bytes written.
+u32 EncodeFrame(const Message& message, FrameType type, char* buffer);
+// Returns the size of the whole frame from its header, or 0 if the header is invalid.
+u32 FrameSize(const char* header);
+// Buffer must hold the whole frame, returns false if it is invalid.
+bool DecodeFrame(const char* buffer, FrameType& type, Message& message);
+
+// The hello frame content, our protocol version.
+Message HelloMessage();
+// A clients hello with what it already has, see Resync.
+Message ResyncHello(u64 server_epoch, const ResyncChannel* channels, u32 channel_count);
+// Returns how many channels the hello has, 0 for a plain hello.
+u32     ReadResyncHello(const Message& hello, u64& server_epoch, ResyncChannel* channels);
+
+int SendFrame(SOCKET socket, const Message& message, FrameType type = FrameMessage);
+int SendHello(SOCKET socket);
+
+// ===== Receive Ring =====
+// Per connection receive buffer. Each recv reads as much as the socket has ready, which can be many frames, and a frame that is only
+// partly here stays in the ring until the rest arrives. Frames are handed out as pointers into the ring, not copied out.
+
+#define RECV_RING_SIZE 16'384 // Must be a power of two and bigger than max_frame_size.
+
+struct RecvRing {
+        // Reads into the free space with a single recv. Returns the recv result, <= 0 when the connection closed or failed.
+        int Fill(SOCKET socket);
+
+        // The contiguous free space to read into, for backends that do the read themselves. Call Commit with the bytes read.
+        char* WriteSpan(u32& length);
+        void  Commit(u32 length);
+
+        // Returns the next complete frame, or nullptr if the next frame hasnt fully arrived yet. Sets invalid if the header is bad.
+        // NOTE: The pointer is only valid until Consume.
+        const char* NextFrame(u32& frame_size, bool& invalid);
+        void        Consume(u32 length);
+
+        u32 Used();
+
+        // A frame that wraps around the end has its start mirrored past the end, so it can always be read in place.
+        char data[RECV_RING_SIZE + max_frame_size];
+        u32  read_pos{};  // Free running, masked on use.
+        u32  write_pos{}; // Free running, masked on use.
+};
+
+// ===== Send Queue =====
+// Per connection outbound frames. Sends during a loop iteration are only queued, the shard flushes every queue once at the end of the
+// iteration so a socket that was sent many frames costs one vectored send instead of one send per frame.
+// Sockets are non blocking, whatever the socket doesnt take stays queued until it is writable again. A client that stops reading only
+// grows its own queue, and once that passes the high water mark each frame's overflow policy decides what happens to it.
+
+#define MAX_SEND_BATCH        1'024         // Frames per vectored send, the most one sendmsg takes (IOV_MAX).
+#define SEND_QUEUE_HIGH_WATER (256 * 1'024) // Bytes queued on one connection before overflow policies apply.
+#define SEND_QUEUE_HARD_LIMIT (1'024 * 1'024)
+
+enum class OverflowPolicy : u8 {
+        Disconnect, // The client cant be allowed to silently miss it, eg. chat messages.
+        Drop,       // Presence updates, not worth losing the client over.
+        Coalesce,   // Only the latest matters, replaces an older queued frame with the same coalesce_key.
+};
+
+struct EncodedFrame {
+        OverflowPolicy policy{ OverflowPolicy::Disconnect };
+        u64            coalesce_key{};
+
+        // NOTE: Whoever made the frame owns the bytes, eg. the buffer of a BufferedFrame or a mapped log segment.
+        const char* data{};
+        u32         size{};
+};
+
+// A frame encoded from a message, what MakeSharedFrame hands out.
+struct BufferedFrame : EncodedFrame {
+        char buffer[max_frame_size];
+};
+
+// Immutable once encoded. A broadcast encodes the message once and queues the same frame on every recipient, it is freed when the last
+// connection has sent it. The count is atomic so frames can be handed to other shards.
+using SharedFrame = std::shared_ptr<const EncodedFrame>;
+
+SharedFrame MakeSharedFrame(const Message& message, FrameType type = FrameMessage, OverflowPolicy policy = OverflowPolicy::Disconnect,
+                            u64 coalesce_key = 0);
+
+enum class PushResult : u8 {
+        Queued,
+        Dropped,
+        Coalesced,
+        Overflowed, // The connection should be disconnected.
+};
+
+struct SendQueue {
+        // NOTE: The first in_flight frames are being written by the backend and are never replaced.
+        PushResult Push(SharedFrame frame, u32 in_flight = 0);
+
+        // Writes as much as the socket takes without blocking. Returns false if the socket failed.
+        bool Flush(SOCKET socket);
+
+        // Pops the bytes the socket accepted.
+        void Consume(u32 bytes_sent);
+        // Drops every frame after the first keep.
+        void Truncate(u32 keep);
+
+        std::deque<SharedFrame> frames;
+        u32                     offset{};       // Bytes of the front frame already sent, for short writes.
+        u32                     queued_bytes{}; // Unsent bytes across all frames.
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+// ===== Sockets =====
+// The networking code is written against the winsock names. On Linux we map those names onto the BSD socket api so that the server can be
+// built for both platforms without ifdefs all over Server.cpp.
+#ifdef LINUX
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using SOCKET = int;
+
+struct WSADATA {};
+
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR   (-1)
+#define SD_SEND        SHUT_WR
+#define MAKEWORD(a, b) ((a) | ((b) << 8))
+
+inline int WSAStartup(int, WSADATA*) {
+        // Writing to a socket the peer has closed raises SIGPIPE, we want the error code instead.
+        signal(SIGPIPE, SIG_IGN);
+        return 0;
+}
+
+inline int WSACleanup() {
+        return 0;
+}
+
+inline int WSAGetLastError() {
+        return errno;
+}
+
+// True if the last call on a non blocking socket failed only because it would have blocked.
+inline bool SocketWouldBlock() {
+        return errno == EAGAIN or errno == EWOULDBLOCK;
+}
+
+inline int closesocket(SOCKET socket) {
+        return close(socket);
+}
+
+inline bool SetSocketBlocking(SOCKET socket, bool blocking) {
+        int flags = fcntl(socket, F_GETFL, 0);
+        if (flags == -1) return false;
+
+        flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+        return fcntl(socket, F_SETFL, flags) == 0;
+}
+
+// ===== Vectored Sends =====
+using IoBuffer = iovec;
+
+inline void SetIoBuffer(IoBuffer& buffer, char* data, unsigned length) {
+        buffer.iov_base = data;
+        buffer.iov_len  = length;
+}
+
+// Sends all the buffers with one syscall. Returns the bytes sent or SOCKET_ERROR.
+inline int SendVectored(SOCKET socket, IoBuffer* buffers, unsigned count) {
+        msghdr message{};
+        message.msg_iov    = buffers;
+        message.msg_iovlen = count;
+
+        return (int)sendmsg(socket, &message, MSG_NOSIGNAL);
+}
+
+// ===== Files =====
+// Pushes everything written to the file through to the disk, returns false on failure.
+inline bool SyncFile(FILE* file) {
+        if (fflush(file) != 0) return false;
+        return fsync(fileno(file)) == 0;
+}
+
+// Maps the whole file read only, the pages are read in as they are touched. Returns nullptr on failure or for an empty file.
+inline const char* MapFileReadOnly(const char* path, size_t& size) {
+        int file = open(path, O_RDONLY | O_CLOEXEC);
+        if (file == -1) return nullptr;
+
+        struct stat file_stat;
+        void*       data = MAP_FAILED;
+        if (fstat(file, &file_stat) == 0 and file_stat.st_size > 0) {
+                size = (size_t)file_stat.st_size;
+                data = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+        }
+
+        // NOTE: The mapping keeps the file open itself.
+        close(file);
+        return data == MAP_FAILED ? nullptr : (const char*)data;
+}
+
+inline void UnmapFile(const char* data, size_t size) {
+        munmap((void*)data, size);
+}
+
+// ===== Threads =====
+inline void PinCurrentThreadToCore(unsigned core) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(core, &cpu_set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+#else
+#include <io.h>
+#include <stdio.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+// True if the last call on a non blocking socket failed only because it would have blocked.
+inline bool SocketWouldBlock() {
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+inline bool SetSocketBlocking(SOCKET socket, bool blocking) {
+        u_long non_blocking = blocking ? 0 : 1;
+        return ioctlsocket(socket, FIONBIO, &non_blocking) == 0;
+}
+
+// ===== Vectored Sends =====
+using IoBuffer = WSABUF;
+
+inline void SetIoBuffer(IoBuffer& buffer, char* data, unsigned length) {
+        buffer.buf = data;
+        buffer.len = length;
+}
+
+// Sends all the buffers with one syscall. Returns the bytes sent or SOCKET_ERROR.
+inline int SendVectored(SOCKET socket, IoBuffer* buffers, unsigned count) {
+        DWORD bytes_sent = 0;
+        if (WSASend(socket, buffers, count, &bytes_sent, 0, nullptr, nullptr) == SOCKET_ERROR) return SOCKET_ERROR;
+
+        return (int)bytes_sent;
+}
+
+// ===== Files =====
+// Pushes everything written to the file through to the disk, returns false on failure.
+inline bool SyncFile(FILE* file) {
+        if (fflush(file) != 0) return false;
+        return _commit(_fileno(file)) == 0;
+}
+
+// Maps the whole file read only, the pages are read in as they are touched. Returns nullptr on failure or for an empty file.
+inline const char* MapFileReadOnly(const char* path, size_t& size) {
+        // NOTE: Share writes, the log writer still has the newest segment open.
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+        LARGE_INTEGER file_size{};
+        HANDLE        mapping = nullptr;
+        if (GetFileSizeEx(file, &file_size) and file_size.QuadPart > 0) {
+                size    = (size_t)file_size.QuadPart;
+                mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+
+        void* data = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size) : nullptr;
+
+        // NOTE: The view keeps the mapping and file open itself.
+        if (mapping != nullptr) CloseHandle(mapping);
+        CloseHandle(file);
+        return (const char*)data;
+}
+
+inline void UnmapFile(const char* data, size_t) {
+        UnmapViewOfFile(data);
+}
+
+// ===== Threads =====
+inline void PinCurrentThreadToCore(unsigned core) {
+        SetThreadAffinityMask(GetCurrentThread(), 1ull << core);
+}
+#endif
\ No newline at end of file
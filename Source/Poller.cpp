@@ -0,0 +1,178 @@
+#include "Poller.h"
+
+#ifdef LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+bool Poller::Init() {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd == -1) return false;
+
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd == -1) return false;
+
+        return Add(wake_fd, wake_poll_key);
+}
+
+void Poller::Shutdown() {
+        if (wake_fd != -1) close(wake_fd);
+        if (epoll_fd != -1) close(epoll_fd);
+        wake_fd  = -1;
+        epoll_fd = -1;
+}
+
+void Poller::Wake() {
+        u64 value = 1;
+        write(wake_fd, &value, sizeof(value));
+}
+
+void Poller::DrainWake() {
+        u64 value;
+        read(wake_fd, &value, sizeof(value));
+}
+
+bool Poller::Add(SOCKET socket, u64 key) {
+        epoll_event event{};
+        event.events   = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = key;
+
+        return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket, &event) == 0;
+}
+
+void Poller::Remove(SOCKET socket) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, socket, nullptr);
+}
+
+void Poller::SetWritable(SOCKET socket, u64 key, bool writable) {
+        epoll_event event{};
+        event.events   = EPOLLIN | EPOLLRDHUP | (writable ? (u32)EPOLLOUT : 0u);
+        event.data.u64 = key;
+
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, socket, &event);
+}
+
+int Poller::Wait(PollEvent* events, int max_events, int timeout_ms) {
+        epoll_event epoll_events[MAX_POLL_EVENTS];
+        if (max_events > MAX_POLL_EVENTS) max_events = MAX_POLL_EVENTS;
+
+        int ready = epoll_wait(epoll_fd, epoll_events, max_events, timeout_ms);
+        if (ready <= 0) return 0; // EINTR is treated like a timeout.
+
+        int event_count = 0;
+        for (int i = 0; i < ready; i++) {
+                if (epoll_events[i].data.u64 == wake_poll_key) {
+                        DrainWake();
+                        continue;
+                }
+
+                u32 flags = 0;
+                if (epoll_events[i].events & EPOLLIN) flags |= PollReadable;
+                if (epoll_events[i].events & EPOLLOUT) flags |= PollWritable;
+                if (epoll_events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP)) flags |= PollClosed;
+
+                events[event_count].key   = epoll_events[i].data.u64;
+                events[event_count].flags = flags;
+                event_count++;
+        }
+
+        return event_count;
+}
+#else
+bool Poller::Init() {
+        wake_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (wake_socket == INVALID_SOCKET) return false;
+
+        // ===== Bind To Any Loopback Port And Connect To Ourself =====
+        sockaddr_in address{};
+        address.sin_family      = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port        = 0;
+
+        int address_length = sizeof(address);
+        if (bind(wake_socket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) return false;
+        if (getsockname(wake_socket, (sockaddr*)&address, &address_length) == SOCKET_ERROR) return false;
+        if (connect(wake_socket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) return false;
+
+        SetSocketBlocking(wake_socket, false);
+
+        return Add(wake_socket, wake_poll_key);
+}
+
+void Poller::Shutdown() {
+        if (wake_socket != INVALID_SOCKET) closesocket(wake_socket);
+        wake_socket = INVALID_SOCKET;
+
+        poll_fds.clear();
+        keys.clear();
+}
+
+void Poller::Wake() {
+        char value = 1;
+        send(wake_socket, &value, 1, 0);
+}
+
+void Poller::DrainWake() {
+        char buffer[64];
+        while (recv(wake_socket, buffer, sizeof(buffer), 0) > 0) {
+        }
+}
+
+bool Poller::Add(SOCKET socket, u64 key) {
+        WSAPOLLFD poll_fd{};
+        poll_fd.fd     = socket;
+        poll_fd.events = POLLRDNORM;
+
+        poll_fds.push_back(poll_fd);
+        keys.push_back(key);
+
+        return true;
+}
+
+void Poller::Remove(SOCKET socket) {
+        for (size_t i = 0; i < poll_fds.size(); i++) {
+                if (poll_fds[i].fd != socket) continue;
+
+                poll_fds[i] = poll_fds.back();
+                keys[i]     = keys.back();
+                poll_fds.pop_back();
+                keys.pop_back();
+                return;
+        }
+}
+
+void Poller::SetWritable(SOCKET socket, u64 key, bool writable) {
+        for (WSAPOLLFD& poll_fd : poll_fds) {
+                if (poll_fd.fd != socket) continue;
+
+                poll_fd.events = POLLRDNORM | (writable ? POLLWRNORM : 0);
+                return;
+        }
+}
+
+int Poller::Wait(PollEvent* events, int max_events, int timeout_ms) {
+        int ready = WSAPoll(poll_fds.data(), (ULONG)poll_fds.size(), timeout_ms);
+        if (ready <= 0) return 0;
+
+        int event_count = 0;
+        for (size_t i = 0; i < poll_fds.size() and event_count < max_events; i++) {
+                SHORT revents = poll_fds[i].revents;
+                if (revents == 0) continue;
+
+                if (keys[i] == wake_poll_key) {
+                        DrainWake();
+                        continue;
+                }
+
+                u32 flags = 0;
+                if (revents & POLLRDNORM) flags |= PollReadable;
+                if (revents & POLLWRNORM) flags |= PollWritable;
+                if (revents & (POLLHUP | POLLERR | POLLNVAL)) flags |= PollClosed;
+
+                events[event_count].key   = keys[i];
+                events[event_count].flags = flags;
+                event_count++;
+        }
+
+        return event_count;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ChatApp.h"
+
+#include <vector>
+
+#define MAX_POLL_EVENTS 256
+
+constexpr u64 wake_poll_key = ~0ull;
+
+enum PollFlags : u32 {
+        PollReadable = 1 << 0,
+        PollWritable = 1 << 1,
+        PollClosed   = 1 << 2, // Hang up or error, the socket should be dropped.
+};
+
+struct PollEvent {
+        u64 key; // Whatever was passed to Add, the server uses the UserID.
+        u32 flags;
+};
+
+// Readiness based event loop over many sockets. Uses epoll on Linux and WSAPoll on Windows.
+// Sockets are watched level triggered for reads, so if we dont drain a socket we will be told about it again next Wait.
+struct Poller {
+        bool Init();
+        void Shutdown();
+
+        bool Add(SOCKET socket, u64 key);
+        void Remove(SOCKET socket);
+        // Also report the socket when it becomes writable, used while a connection has sends the socket couldnt take.
+        void SetWritable(SOCKET socket, u64 key, bool writable);
+
+        // Blocks for at most timeout_ms. Returns the number of events written, 0 on timeout.
+        int Wait(PollEvent* events, int max_events, int timeout_ms);
+
+        // Makes a Wait on another thread return early. Safe to call from any thread.
+        void Wake();
+        void DrainWake();
+
+#ifdef LINUX
+        int epoll_fd{ -1 };
+        int wake_fd{ -1 }; // eventfd
+#else
+        // WSAPoll takes the whole set every call, so keep it packed and swap remove.
+        std::vector<WSAPOLLFD> poll_fds;
+        std::vector<u64>       keys;
+
+        // Windows has no eventfd, so wake with a datagram sent to ourselves on loopback.
+        SOCKET wake_socket{ INVALID_SOCKET };
+#endif
+};
\ No newline at end of file
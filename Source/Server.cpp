@@ -2,8 +2,11 @@
 
 void SyncUsers(Server* server, User& user);
 void SendUserName(Server* server, User& sender_user, UserID wanted_user_id);
+void SendUserNames(Server* server, User& sender_user, const UserID* wanted_user_ids, u32 count);
 void SendUserJoin(Server* server, User& user);
 void LeaveChannel(Server* server, User& user, ChannelID channel_id);
+void RecordMemberChange(Channel& channel, UserID user_id, bool joined);
+void SendMemberDiff(Server* server, User& user, Channel& channel, u64 known_version, bool version_known);
 
 void Server::Init() {
         int res;
@@ -37,6 +40,12 @@ void Server::Init() {
                 return;
         }
 
+#ifdef LINUX
+        // ===== Allow Restarting While Old Connections Are In TIME_WAIT =====
+        int reuse_address = 1;
+        setsockopt(listener_socket, SOL_SOCKET, SO_REUSEADDR, &reuse_address, sizeof(reuse_address));
+#endif
+
         res = bind(listener_socket, result->ai_addr, (int)result->ai_addrlen);
 
         freeaddrinfo(result);
@@ -57,23 +66,585 @@ void Server::Init() {
                 return;
         }
 
+#ifndef LINUX
+        if (backend == ServerBackend::Uring) {
+                std::println("io_uring is only available on Linux, using poll");
+                backend = ServerBackend::Poll;
+        }
+#endif
+
+        // NOTE: Non blocking so that we can accept until the backlog is empty without stalling the loop.
+        if (backend == ServerBackend::Poll) SetSocketBlocking(listener_socket, false);
+
+        // ===== Create Shards =====
+        if (shard_count == 0) shard_count = std::max(1u, std::thread::hardware_concurrency());
+
+        for (u32 shard_idx = 0; shard_idx < shard_count; shard_idx++) {
+                std::unique_ptr<Shard> shard = std::make_unique<Shard>();
+                shard->index                 = shard_idx;
+
+                // ===== Only Shard 0 Accepts, It Hands Connections Out Round Robin =====
+                bool initialised = false;
+#ifdef LINUX
+                if (backend == ServerBackend::Uring) initialised = shard->uring.Init(shard_idx == 0 ? listener_socket : INVALID_SOCKET);
+#endif
+                if (backend == ServerBackend::Poll) {
+                        initialised = shard->poller.Init();
+                        if (shard_idx == 0) initialised = initialised and shard->poller.Add(listener_socket, listener_poll_key);
+                }
+
+                if (!initialised) {
+                        std::println("Failed creating shard {}", shard_idx);
+                        closesocket(listener_socket);
+                        WSACleanup();
+                        return;
+                }
+
+                shards.push_back(std::move(shard));
+        }
+
+        std::println("Running {} shards", shard_count);
+
         running = true;
+        epoch   = (u64)std::chrono::system_clock::now().time_since_epoch().count();
 
         // ===== Create Global Channel =====
-        channels[ChannelIDGlobal]      = {};
-        channels[ChannelIDGlobal].id   = ChannelIDGlobal;
-        channels[ChannelIDGlobal].name = "Global Server";
+        StoreChannelDirectory(std::make_shared<const ChannelDirectory>());
+
+        // NOTE: IDs below ChannelIDUser are reserved, custom channels are handed out after them.
+        channels.SetFirstIndex(ChannelIDUser);
+
+        Channel& global_channel = channels.InsertReserved(ChannelIDGlobal);
+        global_channel.id       = ChannelIDGlobal;
+        global_channel.name     = names.Intern("Global Server");
+        PublishChannel(ChannelIDGlobal);
+
+        Recover();
+
+        // ===== Open The Message Log =====
+        log_enabled = log.Init(log_directory);
+        if (!log_enabled) std::println("Message log disabled, history will only be kept in memory");
+
+        if (log_enabled) snapshot_thread = std::thread(&Server::SnapshotLoop, this);
+}
+
+// The shard the calling thread is running, set once at the start of each shards loop.
+static thread_local Shard* current_shard = nullptr;
+
+void Server::WakeShard(Shard& shard) {
+#ifdef LINUX
+        if (backend == ServerBackend::Uring) {
+                shard.uring.Wake();
+                return;
+        }
+#endif
+
+        shard.poller.Wake();
+}
+
+// ===== Connection Table =====
+Connection* ConnectionTable::Add(UserID user_id, SOCKET socket) {
+        u32 idx = SlotIndex(user_id);
+
+        // ===== Grow To Cover The Slot =====
+        if (idx >= ids.size()) {
+                size_t new_size = std::max((size_t)idx + 1, ids.size() * 2);
+
+                ids.resize(new_size, invalid_slot_id);
+                flags.resize(new_size);
+                sockets.resize(new_size, INVALID_SOCKET);
+                send_queues.resize(new_size);
+                last_heard_ms.resize(new_size);
+#ifdef LINUX
+                uring_connections.resize(new_size);
+#endif
+                cold.resize(new_size);
+        }
+
+        ids[idx]           = user_id;
+        flags[idx]         = 0;
+        sockets[idx]       = socket;
+        cold[idx]          = std::make_unique<Connection>();
+        send_queues[idx]   = &cold[idx]->send_queue;
+        last_heard_ms[idx] = MonotonicMs();
+
+        return cold[idx].get();
+}
+
+void ConnectionTable::Remove(UserID user_id) {
+        if (!Contains(user_id)) return;
+
+        u32 idx          = SlotIndex(user_id);
+        ids[idx]         = invalid_slot_id;
+        flags[idx]       = 0;
+        sockets[idx]       = INVALID_SOCKET;
+        send_queues[idx]   = nullptr;
+        last_heard_ms[idx] = 0;
+#ifdef LINUX
+        uring_connections[idx] = nullptr;
+#endif
+        cold[idx].reset();
+}
+
+bool ConnectionTable::Contains(UserID user_id) const {
+        u32 idx = SlotIndex(user_id);
+        return idx < ids.size() and ids[idx] == user_id;
+}
+
+Connection* ConnectionTable::Get(UserID user_id) {
+        if (!Contains(user_id)) return nullptr;
+
+        return cold[SlotIndex(user_id)].get();
+}
+
+void Server::SendLocal(Shard& shard, UserID user_id, const SharedFrame& frame) {
+        ConnectionTable& connections = shard.connections;
+        if (!connections.Contains(user_id)) return;
+
+        u32 idx   = SlotIndex(user_id);
+        u8& flags = connections.flags[idx];
+        if (flags & ConnectionOverflowed) return;
+
+        PushResult result = PushResult::Queued;
+#ifdef LINUX
+        if (backend == ServerBackend::Uring) result = shard.uring.QueueSend(user_id, *connections.uring_connections[idx], frame);
+#endif
+        if (backend == ServerBackend::Poll) {
+                result = connections.send_queues[idx]->Push(frame);
+
+                if (result == PushResult::Queued and !(flags & ConnectionQueuedForFlush)) {
+                        flags |= ConnectionQueuedForFlush;
+                        shard.flush_list.push_back(user_id);
+                }
+        }
+
+        // ===== Apply Overflow Policy =====
+        switch (result) {
+        case PushResult::Queued: {
+        } break;
+        case PushResult::Dropped: {
+                shard.outbound_stats.dropped++;
+        } break;
+        case PushResult::Coalesced: {
+                shard.outbound_stats.coalesced++;
+        } break;
+        case PushResult::Overflowed: {
+                // NOTE: Cant disconnect here, we may be in the middle of a broadcast holding the registry lock.
+                shard.outbound_stats.overflow_disconnects++;
+                flags |= ConnectionOverflowed;
+                shard.overflowed.push_back(user_id);
+        } break;
+        }
+}
+
+void Server::FlushSends(Shard& shard) {
+        // ===== Drop Clients That Stopped Reading =====
+        // NOTE: Disconnecting a user queues leave messages for others, so these lists can grow while we walk them.
+        for (size_t i = 0; i < shard.overflowed.size(); i++) {
+                std::println("Client {} is not keeping up, disconnecting", shard.overflowed[i]);
+                DisconnectUser(shard, shard.overflowed[i]);
+        }
+        shard.overflowed.clear();
+
+        for (size_t i = 0; i < shard.flush_list.size(); i++) {
+                UserID user_id = shard.flush_list[i];
+
+                if (!shard.connections.Contains(user_id)) continue;
+
+                shard.connections.flags[SlotIndex(user_id)] &= ~ConnectionQueuedForFlush;
+
+                if (!FlushConnection(shard, user_id)) {
+                        std::println("Failed sending to client {}", user_id);
+                        DisconnectUser(shard, user_id);
+                }
+        }
+
+        shard.flush_list.clear();
+}
+
+// Writes whatever the socket will take, anything left waits for the poller to report the socket writable.
+bool Server::FlushConnection(Shard& shard, UserID user_id) {
+        u32        idx        = SlotIndex(user_id);
+        SOCKET     socket     = shard.connections.sockets[idx];
+        SendQueue& send_queue = *shard.connections.send_queues[idx];
+        u8&        flags      = shard.connections.flags[idx];
+
+        if (!send_queue.Flush(socket)) return false;
+
+        bool blocked = !send_queue.frames.empty();
+        if (blocked != bool(flags & ConnectionWaitingWritable)) {
+                flags ^= ConnectionWaitingWritable;
+                shard.poller.SetWritable(socket, user_id, blocked);
+        }
+
+        return true;
+}
+
+// Encodes a message for clients, picking what happens to it if a recipient is too far behind to take it.
+static SharedFrame MakeClientFrame(const Message& message) {
+        // ===== Chat Messages Must Arrive =====
+        if (message.sender != 0 or message.content_length < sizeof(ServerMessageType)) return MakeSharedFrame(message);
+
+        ServerMessageType message_type{};
+        memcpy(&message_type, &message.content[0], sizeof(ServerMessageType));
+
+        switch (message_type) {
+        case MessageUserJoin:
+        case MessageUserLeave:
+        case MessageUserLeaveChannel: {
+                return MakeSharedFrame(message, FrameMessage, OverflowPolicy::Drop);
+        } break;
+        case MessageUserNameSend: {
+                // NOTE: Only the newest name for a user matters.
+                UserID user_id{};
+                memcpy(&user_id, &message.content[sizeof(ServerMessageType)], sizeof(UserID));
+
+                u64 coalesce_key = ((u64)MessageUserNameSend << 32) | user_id;
+                return MakeSharedFrame(message, FrameMessage, OverflowPolicy::Coalesce, coalesce_key);
+        } break;
+        default: {
+                return MakeSharedFrame(message);
+        } break;
+        }
+}
+
+void Server::Send(User& user, const Message& message) {
+        Shard&      shard = *current_shard;
+        SharedFrame frame = MakeClientFrame(message);
+
+        if (user.shard == shard.index) {
+                SendLocal(shard, user.id, frame);
+                return;
+        }
+
+        // ===== Hand Over To The Owning Shard =====
+        Shard& owner = *shards[user.shard];
+        {
+                std::lock_guard lock(owner.mailbox.mutex);
+                owner.mailbox.broadcasts.push_back({ std::move(frame), { user.id }, nullptr });
+        }
+        WakeShard(owner);
+}
+
+void Server::Broadcast(ChannelID channel_id, const Message& message) {
+        Shard& shard = *current_shard;
+
+        CachedChannel* cached = LoadCachedChannel(shard, channel_id);
+        if (cached == nullptr or cached->members == nullptr) return;
+
+        // NOTE: Stays alive until the next loop iteration even if the cache replaces it, see Channel Cache.
+        const ChannelMembers& members = *cached->members;
+
+        // NOTE: Encoded once, every recipient on every shard queues the same frame.
+        SharedFrame frame = MakeClientFrame(message);
+
+        // ===== Send To Local Members =====
+        for (UserID user_id : members.by_shard[shard.index]) {
+                SendLocal(shard, user_id, frame);
+        }
+
+        // ===== One Handoff Per Remote Shard =====
+        // NOTE: The snapshot already groups members by shard, so each shard is just handed the snapshot. Only shared once something
+        // actually goes to another shard.
+        ChannelMembersPtr shared_members;
+        for (u32 shard_idx = 0; shard_idx < shards.size(); shard_idx++) {
+                if (shard_idx == shard.index or members.by_shard[shard_idx].empty()) continue;
+                if (shared_members == nullptr) shared_members = cached->members;
+
+                Shard& owner = *shards[shard_idx];
+                {
+                        std::lock_guard lock(owner.mailbox.mutex);
+                        owner.mailbox.broadcasts.push_back({ frame, {}, shared_members });
+                }
+                WakeShard(owner);
+        }
+}
+
+void Server::PublishChannel(ChannelID channel_id) {
+        Channel* channel = channels.Get(channel_id);
+        if (channel == nullptr) return;
+
+        // ===== Build The New Snapshot =====
+        std::shared_ptr<ChannelMembers> members = std::make_shared<ChannelMembers>();
+        members->by_shard.resize(shards.size());
+
+        for (UserID user_id : channel->users) {
+                User* user = users.Get(user_id);
+                if (user == nullptr) continue;
+
+                members->by_shard[user->shard].push_back(user_id);
+                members->users.Insert(user_id);
+        }
+
+        // ===== Swap It In =====
+        std::shared_ptr<const ChannelDirectory> directory = channel_directory.load();
+
+        // NOTE: The version is bumped after the store, a shard that sees the new version always loads these members or newer.
+        auto route_it = directory->find(channel_id);
+        if (route_it != directory->end()) {
+                route_it->second->members.store(std::move(members));
+                route_it->second->members_version.fetch_add(1, std::memory_order_release);
+                return;
+        }
+
+        // ===== New Channel, Copy The Directory With A Route For It =====
+        std::shared_ptr<ChannelRoute> route = std::make_shared<ChannelRoute>();
+        route->members.store(std::move(members));
+        route->history.depth = history_depth;
+
+        std::shared_ptr<ChannelDirectory> new_directory = std::make_shared<ChannelDirectory>(*directory);
+        (*new_directory)[channel_id]                    = std::move(route);
+        StoreChannelDirectory(std::move(new_directory));
+}
+
+void Server::UnpublishChannel(ChannelID channel_id) {
+        std::shared_ptr<const ChannelDirectory> directory = channel_directory.load();
+
+        auto route_it = directory->find(channel_id);
+        if (route_it == directory->end()) return;
+
+        // ===== End Its Log =====
+        // NOTE: Under the history lock, so no message a shard is still handling for the channel can be logged after the removal record.
+        {
+                ChannelRoute& route = *route_it->second;
+
+                std::lock_guard lock(route.history_mutex);
+                route.removed = true;
+                if (log_enabled) log.AppendChannelRemoved(channel_id);
+        }
+
+        std::shared_ptr<ChannelDirectory> new_directory = std::make_shared<ChannelDirectory>(*directory);
+        new_directory->erase(channel_id);
+        StoreChannelDirectory(std::move(new_directory));
+}
+
+void Server::StoreChannelDirectory(std::shared_ptr<const ChannelDirectory> directory) {
+        channel_directory.store(std::move(directory));
+        directory_version.fetch_add(1, std::memory_order_release);
+}
+
+std::shared_ptr<ChannelRoute> Server::LoadChannelRoute(ChannelID channel_id) {
+        std::shared_ptr<const ChannelDirectory> directory = channel_directory.load();
+
+        auto route_it = directory->find(channel_id);
+        if (route_it == directory->end()) return nullptr;
+
+        return route_it->second;
+}
+
+CachedChannel* Server::LoadCachedChannel(Shard& shard, ChannelID channel_id) {
+        // ===== Directory Changed =====
+        // NOTE: Channels were created or removed, rare next to messages. Removed channels are dropped from the cache, so are ones whose ID
+        // now routes somewhere else, the ID can come back for a new channel before this shard looks again.
+        u64 version = directory_version.load(std::memory_order_acquire);
+        if (version != shard.directory_version) {
+                if (shard.directory != nullptr) shard.retired_directories.push_back(std::move(shard.directory));
+                shard.directory         = channel_directory.load();
+                shard.directory_version = version;
+
+                for (auto cached_it = shard.channels.begin(); cached_it != shard.channels.end();) {
+                        auto route_it = shard.directory->find(cached_it->first);
+                        if (route_it != shard.directory->end() and route_it->second == cached_it->second.route) {
+                                cached_it++;
+                                continue;
+                        }
+
+                        shard.retired_members.push_back(std::move(cached_it->second.members));
+                        cached_it = shard.channels.erase(cached_it);
+                }
+        }
+
+        // ===== First Use On This Shard =====
+        auto cached_it = shard.channels.find(channel_id);
+        if (cached_it == shard.channels.end()) {
+                auto route_it = shard.directory->find(channel_id);
+                if (route_it == shard.directory->end()) return nullptr;
+
+                cached_it               = shard.channels.try_emplace(channel_id).first;
+                cached_it->second.route = route_it->second;
+        }
+
+        // ===== Members Changed =====
+        CachedChannel& cached          = cached_it->second;
+        u64            members_version = cached.route->members_version.load(std::memory_order_acquire);
+        if (members_version != cached.members_version) {
+                if (cached.members != nullptr) shard.retired_members.push_back(std::move(cached.members));
+                cached.members         = cached.route->members.load();
+                cached.members_version = members_version;
+        }
+
+        return &cached;
+}
+
+void Server::ReleaseRetiredChannels(Shard& shard) {
+        shard.retired_directories.clear();
+        shard.retired_members.clear();
+}
+
+// ===== Snapshots =====
+void Server::Recover() {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        // ===== Load The Snapshot =====
+        Snapshot snapshot{};
+        u64      first_segment = 0;
+
+        if (ReadSnapshot(SnapshotPath(log_directory), snapshot)) {
+                users.RestoreGenerations(snapshot.user_generations);
+                channels.RestoreGenerations(snapshot.channel_generations);
+
+                for (SnapshotChannel& saved : snapshot.channels) {
+                        // NOTE: Custom channels only last while they have members, and nobody is connected after a restart.
+                        std::shared_ptr<ChannelRoute> route = LoadChannelRoute(saved.id);
+                        if (route == nullptr) continue;
+
+                        route->last_seq = saved.last_seq;
+
+                        for (SnapshotMessage& saved_message : saved.history) {
+                                Message message{};
+                                message.sender         = saved_message.sender;
+                                message.channel        = saved.id;
+                                message.timestamp      = saved_message.timestamp;
+                                message.seq            = saved_message.seq;
+                                message.content_length = (u32)saved_message.content.size();
+                                memcpy(message.content, saved_message.content.data(), message.content_length);
+
+                                route->history.Push(message);
+                        }
+                }
+
+                log.index     = std::move(snapshot.log_index);
+                first_segment = snapshot.log_segment;
+        }
+
+        // ===== Replay The Log Written After It =====
+        // NOTE: A segment is only read up to its first bad record, that is where a crash tore it. Later segments are from later runs.
+        u64       replayed = 0;
+        LogReader reader;
+        Message   message;
+
+        for (u64 segment_index : ListLogSegments(log_directory)) {
+                if (segment_index < first_segment) continue;
+                if (!reader.Open(LogSegmentPath(log_directory, segment_index))) continue;
+
+                u64 record_offset = reader.offset;
+                while (reader.Next(message)) {
+                        // NOTE: Every record, custom channels from before the restart can still be read back. A removal record forgets the
+                        // channels earlier ones again.
+                        log.IndexRecord(message.channel, message.seq, segment_index, record_offset);
+                        record_offset = reader.offset;
+
+                        // NOTE: The snapshot only knows the generations from when it was taken, these IDs may have come after it.
+                        channels.SkipGeneration(message.channel);
+                        users.SkipGeneration(message.sender);
+
+                        std::shared_ptr<ChannelRoute> route = LoadChannelRoute(message.channel);
+                        if (route == nullptr or message.seq <= route->last_seq) continue;
+
+                        route->last_seq = message.seq;
+                        route->history.Push(message);
+                        replayed++;
+                }
+        }
+
+        channels.RebuildFreeIndices();
+        users.RebuildFreeIndices();
+
+        u64 elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::println("Recovered in {} ms, replayed {} messages from the log", elapsed_ms, replayed);
+}
+
+void Server::SnapshotLoop() {
+        while (true) {
+                {
+                        std::unique_lock lock(snapshot_mutex);
+                        snapshot_wake.wait_for(lock, std::chrono::milliseconds(snapshot_interval_ms), [&] { return !running; });
+                        if (!running) return;
+                }
+
+                TakeSnapshot();
+        }
+}
+
+// Never stops the shards. Only server messages wait on the registry while ids are copied, and each channel only holds up its own chat
+// messages while its history is copied.
+void Server::CaptureSnapshot(Snapshot& snapshot) {
+        // NOTE: Before any seq below is read. Anything appended after can only be in this segment or a later one, so replay starts here.
+        snapshot.log_segment = log.segment_index.load();
+
+        std::shared_ptr<const ChannelDirectory> directory;
+        {
+                std::lock_guard lock(registry_mutex);
+
+                snapshot.user_generations    = users.RetiredGenerations();
+                snapshot.channel_generations = channels.RetiredGenerations();
+
+                directory = channel_directory.load();
+        }
+
+        {
+                std::lock_guard lock(log.index_mutex);
+                snapshot.log_index = log.index;
+        }
+
+        for (const auto& [channel_id, route] : *directory) {
+                SnapshotChannel& saved = snapshot.channels.emplace_back();
+                saved.id               = channel_id;
+
+                std::lock_guard lock(route->history_mutex);
+
+                saved.last_seq = route->last_seq;
+                saved.history.reserve(route->history.Count());
+
+                for (u32 entry_idx = 0; entry_idx < route->history.Count(); entry_idx++) {
+                        HistoryEntry& entry = route->history.Get(entry_idx);
+                        saved.history.push_back({ entry.seq, entry.sender, entry.timestamp, std::string(entry.content, entry.content_length) });
+                }
+        }
+}
+
+void Server::TakeSnapshot() {
+        Snapshot snapshot{};
+        CaptureSnapshot(snapshot);
+
+        if (!WriteSnapshot(SnapshotPath(log_directory), snapshot)) std::println("Failed writing snapshot");
 }
 
 void Server::Shutdown() {
-        running = false;
+        {
+                std::lock_guard lock(snapshot_mutex);
+                running = false;
+        }
+        snapshot_wake.notify_one();
+        if (snapshot_thread.joinable()) snapshot_thread.join();
+
+        for (std::unique_ptr<Shard>& shard : shards) {
+                OutboundStats& stats = shard->outbound_stats;
+                std::println("Shard {}: {} frames dropped, {} coalesced, {} slow clients disconnected", shard->index, stats.dropped, stats.coalesced,
+                             stats.overflow_disconnects);
 
-        // Need to ensure AcceptConnections is no longer running so that we dont accept more clients...
+                for (UserID user_id : shard->connections.ids) {
+                        if (user_id == invalid_slot_id) continue;
 
-        for (int i = 0; i < client_count; i++) {
-                client_threads[i].join();
+                        closesocket(shard->connections.sockets[SlotIndex(user_id)]);
+                }
+                shard->connections = {};
+
+#ifdef LINUX
+                if (backend == ServerBackend::Uring) shard->uring.Shutdown();
+#endif
+                if (backend == ServerBackend::Poll) shard->poller.Shutdown();
+        }
+        shards.clear();
+
+        // NOTE: After the shards have stopped, so nothing else can be appended. The last snapshot then covers the whole log.
+        if (log_enabled) {
+                log.Shutdown();
+                TakeSnapshot();
         }
 
+        users.Clear();
+
         closesocket(listener_socket);
         WSACleanup();
 }
@@ -84,12 +655,12 @@ void ProcessMessage(Server* server, User& user, Message& message) {
                 // ===== Handle Server Message =====
                 // TODO: Get option, and handle
                 // NOTE: If username change we will need to send this through to all clients so that they can update their local name for that user.
-                std::string content(message.content, message.content_length);
+                std::string_view content(message.content, message.content_length);
                 if (content.starts_with("username")) {
                         bool is_joining = false;
-                        if (server->users[user.id].user_name.empty()) is_joining = true;
+                        if (user.user_name == empty_string) is_joining = true;
 
-                        server->users[user.id].user_name = std::string(content.substr(9));
+                        user.user_name = server->names.Intern(content.substr(9));
 
                         SendUserJoin(server, user);
                         return;
@@ -99,9 +670,6 @@ void ProcessMessage(Server* server, User& user, Message& message) {
                 memcpy(&message_type, &message.content[0], sizeof(ServerMessageType));
 
                 switch (message_type) {
-                case MessagePing: {
-                        // ===== Dont need to do anything. Client is pinging server =====
-                } break;
                 case MessageUserListSync: {
                         SyncUsers(server, user);
                 } break;
@@ -111,6 +679,20 @@ void ProcessMessage(Server* server, User& user, Message& message) {
 
                         SendUserName(server, user, wanted_user_id);
                 } break;
+                case MessageUserNamesRequest: {
+                        if (message.content_length < NAME_LOOKUP_HEADER_SIZE) break;
+
+                        u16 count;
+                        memcpy(&count, &message.content[sizeof(ServerMessageType)], sizeof(u16));
+
+                        // NOTE: Never trust the count, only read IDs that are actually there.
+                        u32    ids_sent = (message.content_length - NAME_LOOKUP_HEADER_SIZE) / (u32)sizeof(UserID);
+                        u32    id_count = std::min({ (u32)count, (u32)MAX_NAME_LOOKUPS, ids_sent });
+                        UserID wanted_user_ids[MAX_NAME_LOOKUPS];
+                        memcpy(wanted_user_ids, &message.content[NAME_LOOKUP_HEADER_SIZE], id_count * sizeof(UserID));
+
+                        SendUserNames(server, user, wanted_user_ids, id_count);
+                } break;
                 case MessageUserInvite: {
                         ChannelID channel_id;
                         memcpy(&channel_id, &message.content[sizeof(ServerMessageType)], sizeof(ChannelID));
@@ -118,25 +700,36 @@ void ProcessMessage(Server* server, User& user, Message& message) {
                         UserID invited_user_id;
                         memcpy(&invited_user_id, &message.content[sizeof(ServerMessageType) + sizeof(ChannelID)], sizeof(UserID));
 
-                        User invited_user = server->users[invited_user_id];
+                        // NOTE: find, operator[] would register a user for any id a client sends us.
+                        User* invited_user = server->users.Get(invited_user_id);
+                        if (invited_user == nullptr or !server->channels.Contains(channel_id)) break;
 
                         server->AddUserToChannel(channel_id, invited_user_id);
 
-                        SyncUsers(server, invited_user);
+                        SyncUsers(server, *invited_user);
                 } break;
                 case MessageCreateChannel: {
                         UserID invited_user_id;
                         memcpy(&invited_user_id, &message.content[sizeof(ServerMessageType)], sizeof(UserID));
 
-                        User invited_user = server->users[invited_user_id];
+                        User* invited_user = server->users.Get(invited_user_id);
+                        if (invited_user == nullptr) break;
+
+                        // NOTE: Only built once when the channel is made, everything after refers to it by handle.
+                        std::string channel_name;
+                        channel_name += server->names.Get(user.user_name);
+                        channel_name += " - ";
+                        channel_name += server->names.Get(invited_user->user_name);
+
+                        StringHandle channel_name_handle = server->names.Intern(channel_name);
 
-                        std::string channel_name = user.user_name + " - " + invited_user.user_name;
+                        ChannelID created_channel_id = server->CreateUserChannel(user, channel_name_handle);
+                        if (created_channel_id == invalid_slot_id) break;
 
-                        ChannelID created_channel_id = server->CreateUserChannel(user, channel_name);
                         server->AddUserToChannel(created_channel_id, invited_user_id);
 
                         SyncUsers(server, user);
-                        SyncUsers(server, invited_user);
+                        SyncUsers(server, *invited_user);
                 } break;
                 case MessageUserLeaveChannel: {
                         ChannelID channel_id;
@@ -151,20 +744,7 @@ void ProcessMessage(Server* server, User& user, Message& message) {
         } break;
 
         default: {
-                // ===== Handle Message =====
-                std::println("Message from client recieved: {}", message.content);
-
-                message.sender = user.id;
-
-                for (u32 i = 0; i < server->channels[message.channel].user_count; i++) {
-                        int    send_flags = 0;
-                        UserID user_id    = server->channels[message.channel].users[i];
-                        send(server->users[user_id].socket, (char*)&message, sizeof(Message), send_flags);
-
-                        std::println("Sending to: {}", user_id);
-                        std::println("Sending from: {}", message.sender);
-                }
-
+                // NOTE: Chat messages dont come through here, HandleMessage broadcasts them without taking the registry lock.
         } break;
         }
 }
@@ -190,38 +770,123 @@ void SyncUsers(Server* server, User& user) {
 
         for (u32 channel_idx = 0; channel_idx < user.channel_count; channel_idx++) {
                 ChannelID channel_id = user.channels[channel_idx];
-                Channel&  channel    = server->channels[channel_id];
+                Channel*  channel    = server->channels.Get(channel_id);
+                if (channel == nullptr) continue;
 
                 // ===== Set Channel ID =====
                 message.channel = channel_id;
 
-                for (u32 user_idx = 0; user_idx < channel.user_count; user_idx++) {
-                        UserID user_id = channel.users[user_idx];
-
-                        // ===== Write User ID to message =====
-                        memcpy(&message.content[message.content_length], &user_id, sizeof(user_id));
-                        message.content_length += sizeof(user_id);
-
+                for (UserID user_id : channel->users) {
                         if (message.content_length + sizeof(user_id) > message_buffer_length) {
                                 // ===== Send Message =====
-                                int send_flags = 0;
-                                send(user.socket, (char*)&message, sizeof(Message), send_flags);
+                                server->Send(user, message);
 
                                 // ===== Clear Content =====
                                 message.content_length = sizeof(ServerMessageType);
                         }
+
+                        // ===== Write User ID to message =====
+                        memcpy(&message.content[message.content_length], &user_id, sizeof(user_id));
+                        message.content_length += sizeof(user_id);
                 }
 
                 // ===== If no users we dont need to send =====
                 if (message.content_length <= sizeof(ServerMessageType)) continue;
 
                 // ===== Send =====
-                int send_flags = 0;
-                send(user.socket, (char*)&message, sizeof(Message), send_flags);
+                // NOTE: Only the last one has the version, see Resync.
+                message.seq = channel->members_version;
+                server->Send(user, message);
+                message.seq            = 0;
                 message.content_length = sizeof(ServerMessageType);
         }
 }
 
+// Caller holds registry_mutex.
+void RecordMemberChange(Channel& channel, UserID user_id, bool joined) {
+        channel.members_version++;
+        MemberChange change = { channel.members_version, user_id, joined };
+
+        // NOTE: Most channels never see many changes, so the vector only grows as far as it needs to.
+        if (channel.member_changes.size() < MAX_MEMBER_CHANGES) {
+                channel.member_changes.push_back(change);
+        } else {
+                channel.member_changes[channel.oldest_member_change] = change;
+                channel.oldest_member_change                        = (channel.oldest_member_change + 1) % MAX_MEMBER_CHANGES;
+        }
+}
+
+// Who joined and left the channel since known_version, or everyone if we dont have the changes that far back. See Resync.
+void SendMemberDiff(Server* server, User& user, Channel& channel, u64 known_version, bool version_known) {
+        std::vector<UserID> added;
+        std::vector<UserID> removed;
+
+        u32  change_count   = (u32)channel.member_changes.size();
+        u64  oldest_version = change_count == 0 ? channel.members_version : channel.member_changes[channel.oldest_member_change].version - 1;
+        bool reset          = !version_known or known_version < oldest_version or known_version > channel.members_version;
+
+        if (reset) {
+                added.assign(channel.users.begin(), channel.users.end());
+        } else {
+                // ===== Net Change For Each User =====
+                // NOTE: Someone who joined and left again since then doesnt need to be sent at all.
+                std::unordered_map<UserID, bool> was_member; // At known_version, the opposite of their first change after it.
+                std::unordered_map<UserID, bool> is_member;
+                for (u32 i = 0; i < change_count; i++) {
+                        const MemberChange& change = channel.member_changes[(channel.oldest_member_change + i) % change_count];
+                        if (change.version <= known_version) continue;
+
+                        was_member.try_emplace(change.user_id, !change.joined);
+                        is_member[change.user_id] = change.joined;
+                }
+
+                for (const auto& [user_id, member] : is_member) {
+                        if (member == was_member[user_id]) continue;
+
+                        if (member) added.push_back(user_id);
+                        else removed.push_back(user_id);
+                }
+        }
+
+        Message message{};
+        message.sender    = 0;
+        message.channel   = channel.id;
+        message.timestamp = 0;
+
+        ServerMessageType message_type = MessageUserListDiff;
+        u8                flags        = reset ? MemberDiffReset : 0;
+        u32               ids_per_diff = (message_buffer_length - (sizeof(ServerMessageType) + sizeof(u8) + sizeof(u16))) / sizeof(UserID);
+
+        // ===== Split Over As Many Messages As It Takes =====
+        // NOTE: Always at least one, the client needs the version even if nothing changed.
+        size_t added_idx   = 0;
+        size_t removed_idx = 0;
+        bool   last        = false;
+        while (!last) {
+                u16 added_count   = (u16)std::min(added.size() - added_idx, (size_t)ids_per_diff);
+                u32 removed_count = (u32)std::min(removed.size() - removed_idx, (size_t)(ids_per_diff - added_count));
+
+                memcpy(&message.content[0], &message_type, sizeof(ServerMessageType));
+                memcpy(&message.content[4], &flags, sizeof(u8));
+                memcpy(&message.content[5], &added_count, sizeof(u16));
+                message.content_length = 7;
+
+                memcpy(&message.content[message.content_length], added.data() + added_idx, added_count * sizeof(UserID));
+                message.content_length += added_count * sizeof(UserID);
+                memcpy(&message.content[message.content_length], removed.data() + removed_idx, removed_count * sizeof(UserID));
+                message.content_length += removed_count * sizeof(UserID);
+
+                added_idx   += added_count;
+                removed_idx += removed_count;
+                last         = added_idx == added.size() and removed_idx == removed.size();
+
+                message.seq = last ? channel.members_version : 0;
+                server->Send(user, message);
+
+                flags = 0; // Only the first one clears.
+        }
+}
+
 void SendUserName(Server* server, User& sender_user, UserID wanted_user_id) {
         Message message{};
         message.sender    = 0;
@@ -237,14 +902,59 @@ void SendUserName(Server* server, User& sender_user, UserID wanted_user_id) {
         message.content_length += sizeof(UserID);
 
         // ===== Write User Name =====
-        User& wanted_user     = server->users[wanted_user_id];
-        u32   username_length = (u32)wanted_user.user_name.size();
-        memcpy(&message.content[message.content_length], wanted_user.user_name.c_str(), username_length);
-        message.content_length += username_length;
+        User* wanted_user = server->users.Get(wanted_user_id);
+        if (wanted_user == nullptr) return;
+
+        std::string_view user_name = server->names.Get(wanted_user->user_name);
+        memcpy(&message.content[message.content_length], user_name.data(), user_name.size());
+        message.content_length += (u32)user_name.size();
 
         // ===== Send Message =====
-        int send_flags = 0;
-        send(sender_user.socket, (char*)&message, sizeof(Message), send_flags);
+        server->Send(sender_user, message);
+}
+
+// Sends a names message once it is full, or for the last names, and starts the next one.
+static void FlushUserNames(Server* server, User& sender_user, Message& message, u16& name_count) {
+        memcpy(&message.content[sizeof(ServerMessageType)], &name_count, sizeof(u16));
+        server->Send(sender_user, message);
+
+        message.content_length = NAME_LOOKUP_HEADER_SIZE;
+        name_count             = 0;
+}
+
+void SendUserNames(Server* server, User& sender_user, const UserID* wanted_user_ids, u32 count) {
+        Message message{};
+        u16     name_count = 0;
+
+        // ===== Write Message Type =====
+        ServerMessageType message_type = MessageUserNamesSend;
+        memcpy(&message.content[0], &message_type, sizeof(ServerMessageType));
+        message.content_length = NAME_LOOKUP_HEADER_SIZE;
+
+        for (u32 id_idx = 0; id_idx < count; id_idx++) {
+                UserID wanted_user_id = wanted_user_ids[id_idx];
+
+                // ===== Look Up Name =====
+                // NOTE: Unknown IDs still get an entry so the client stops waiting on them. A name is cut short if even alone it wouldnt fit.
+                std::string_view user_name{};
+                User*            wanted_user = server->users.Get(wanted_user_id);
+                if (wanted_user != nullptr) user_name = server->names.Get(wanted_user->user_name);
+                user_name = user_name.substr(0, message_buffer_length - NAME_LOOKUP_HEADER_SIZE - NAME_LOOKUP_ENTRY_SIZE);
+
+                u16 name_length = (u16)user_name.size();
+                if (message.content_length + NAME_LOOKUP_ENTRY_SIZE + name_length > message_buffer_length) {
+                        FlushUserNames(server, sender_user, message, name_count);
+                }
+
+                // ===== Write Entry =====
+                memcpy(&message.content[message.content_length], &wanted_user_id, sizeof(UserID));
+                memcpy(&message.content[message.content_length + sizeof(UserID)], &name_length, sizeof(u16));
+                memcpy(&message.content[message.content_length + NAME_LOOKUP_ENTRY_SIZE], user_name.data(), name_length);
+                message.content_length += NAME_LOOKUP_ENTRY_SIZE + name_length;
+                name_count++;
+        }
+
+        if (name_count > 0) FlushUserNames(server, sender_user, message, name_count);
 }
 
 void SendUserJoin(Server* server, User& user) {
@@ -263,8 +973,9 @@ void SendUserJoin(Server* server, User& user) {
         message.content_length += sizeof(UserID);
 
         // ===== Write User Name =====
-        memcpy(&message.content[message.content_length], user.user_name.data(), user.user_name.size());
-        message.content_length += (u32)user.user_name.size();
+        std::string_view user_name = server->names.Get(user.user_name);
+        memcpy(&message.content[message.content_length], user_name.data(), user_name.size());
+        message.content_length += (u32)user_name.size();
 
         // ===== Send a Message for Each Channel =====
         for (u32 channel_idx = 0; channel_idx < user.channel_count; channel_idx++) {
@@ -272,16 +983,8 @@ void SendUserJoin(Server* server, User& user) {
 
                 message.channel = channel_id;
 
-                // ===== Send a message to each User in the Channel =====
-                Channel channel = server->channels[channel_id];
-                for (u32 channel_user_idx = 0; channel_user_idx < channel.user_count; channel_user_idx++) {
-                        UserID user_id      = channel.users[channel_user_idx];
-                        User   channel_user = server->users[user_id];
-
-                        // ===== Send Message =====
-                        int send_flags = 0;
-                        send(channel_user.socket, (char*)&message, sizeof(Message), send_flags);
-                }
+                // ===== Send to each User in the Channel =====
+                server->Broadcast(channel_id, message);
         }
 }
 
@@ -301,8 +1004,9 @@ void SendUserLeave(Server* server, User& user) {
         message.content_length += sizeof(UserID);
 
         // ===== Write User Name =====
-        memcpy(&message.content[message.content_length], user.user_name.data(), user.user_name.size());
-        message.content_length += (u32)user.user_name.size();
+        std::string_view user_name = server->names.Get(user.user_name);
+        memcpy(&message.content[message.content_length], user_name.data(), user_name.size());
+        message.content_length += (u32)user_name.size();
 
         // ===== Send a Message for Each Channel =====
         for (u32 channel_idx = 0; channel_idx < user.channel_count; channel_idx++) {
@@ -310,16 +1014,8 @@ void SendUserLeave(Server* server, User& user) {
 
                 message.channel = channel_id;
 
-                // ===== Send a message to each User in the Channel =====
-                Channel channel = server->channels[channel_id];
-                for (u32 channel_user_idx = 0; channel_user_idx < channel.user_count; channel_user_idx++) {
-                        UserID user_id      = channel.users[channel_user_idx];
-                        User   channel_user = server->users[user_id];
-
-                        // ===== Send Message =====
-                        int send_flags = 0;
-                        send(channel_user.socket, (char*)&message, sizeof(Message), send_flags);
-                }
+                // ===== Send to each User in the Channel =====
+                server->Broadcast(channel_id, message);
         }
 }
 
@@ -339,21 +1035,15 @@ void SendUserLeaveChannel(Server* server, User& user, ChannelID channel_id) {
         message.content_length += sizeof(UserID);
 
         // ===== Write User Name =====
-        memcpy(&message.content[message.content_length], user.user_name.data(), user.user_name.size());
-        message.content_length += (u32)user.user_name.size();
+        std::string_view user_name = server->names.Get(user.user_name);
+        memcpy(&message.content[message.content_length], user_name.data(), user_name.size());
+        message.content_length += (u32)user_name.size();
 
         message.channel = channel_id;
 
-        // ===== Send a message to each User in the Channel =====
-        Channel channel = server->channels[channel_id];
-        for (u32 channel_user_idx = 0; channel_user_idx < channel.user_count; channel_user_idx++) {
-                UserID user_id      = channel.users[channel_user_idx];
-                User   channel_user = server->users[user_id];
-
-                // ===== Send Message =====
-                int send_flags = 0;
-                send(channel_user.socket, (char*)&message, sizeof(Message), send_flags);
-        }
+        // ===== Send to each User in the Channel =====
+        // NOTE: The leaving user is still in the published members, so they get it too.
+        server->Broadcast(channel_id, message);
 }
 
 // Needed so clients know who they are.
@@ -373,84 +1063,368 @@ void SendUserID(Server* server, User& user) {
         message.content_length += sizeof(UserID);
 
         // ===== Send Message =====
-        int send_flags = 0;
-        send(user.socket, (char*)&message, sizeof(Message), send_flags);
+        server->Send(user, message);
 }
 
 void LeaveChannel(Server* server, User& user, ChannelID channel_id) {
-        Channel& channel = server->channels[channel_id];
-
-        // ===== Loop all users to find user =====
-        for (u32 user_idx = 0; user_idx < channel.user_count; user_idx++) {
-                UserID user_id = channel.users[user_idx];
-                if (user_id != user.id) continue;
+        Channel* channel = server->channels.Get(channel_id);
+        if (channel == nullptr) return;
 
+        if (channel->users.Contains(user.id)) {
                 // ===== Send Leave Message =====
                 SendUserLeaveChannel(server, user, channel_id);
 
                 // ===== Then Remove User =====
                 // NOTE: Do After send, as we want the leaving user to get the message too.
-                channel.user_count--;
-                channel.users[user_idx] = channel.users[channel.user_count];
-
-                break;
+                channel->users.Remove(user.id);
+                RecordMemberChange(*channel, user.id, false);
         }
 
         // ===== Remove Custom Channels with 0 Users =====
-        if (channel.user_count == 0 and channel_id != ChannelIDGlobal) {
-                server->channels.erase(channel_id);
+        // NOTE: Frees the slot, anything still holding this ID is rejected from now on.
+        if (channel->users.Count() == 0 and channel_id != ChannelIDGlobal) {
+                server->channels.Remove(channel_id);
+                server->UnpublishChannel(channel_id);
+                return;
         }
+
+        server->PublishChannel(channel_id);
 }
 
-// NOTE: Send message to all client to tell them the server is down.
-void ProcessClient(Server* server, User& user, bool& running) {
-        int res;
+// Chat messages only need channel membership and their channels history lock, so shards handle different channels fully in parallel.
+// Server messages can change users and channels.
+void Server::HandleMessage(UserID user_id, Message& message) {
+        message.sender = user_id;
 
-        SyncUsers(server, user);
+        // ===== Chat Message =====
+        if (message.channel != ChannelIDServer) {
+                CachedChannel* cached = LoadCachedChannel(*current_shard, message.channel);
+                if (cached == nullptr) return;
 
-        Message message;
+                ChannelRoute* route = cached->route.get();
+                {
+                        std::lock_guard lock(route->history_mutex);
+                        if (route->removed) return;
 
-        while (running) {
-                // NOTE: Call select first to check status of the socket, it allows specifying a time out so we can check if the server is still
-                // running whilst waiting for message.
-                fd_set sockets_to_check{};
-                sockets_to_check.fd_count    = 1;
-                sockets_to_check.fd_array[0] = user.socket;
-
-                timeval time_out_duration{ 0, 100 };
-                int     num_sockets_ready = select(0, &sockets_to_check, nullptr, nullptr, &time_out_duration); // 100 ms timeout
-                if (num_sockets_ready == 0) continue;
-
-                int recieve_flags = 0;
-                res               = recv(user.socket, (char*)&message, sizeof(message), recieve_flags);
-
-                if (res > 0) { // Success
-                        message.sender = user.id;
-                        ProcessMessage(server, user, message);
-                } else if (res == 0) { // Closing Connection
-                        std::println("res == 0");
-                        break;
-                } else { // Error
-                        std::println("Recieve failed");
-                        closesocket(user.socket);
-                        break;
+                        message.seq = ++route->last_seq;
+                        route->history.Push(message);
+
+                        // NOTE: Only copies into the logs buffer, the write and fsync happen on the log thread.
+                        if (log_enabled) log.Append(message);
+
+                        // NOTE: Queued before the lock is released, so every member receives the channels messages in seq order even when
+                        // several shards send to it at once. Only takes the mailbox locks, never another history lock.
+                        Broadcast(message.channel, message);
+                }
+
+                return;
+        }
+
+        // NOTE: Pings and history requests only read the channels members, history and log, so they dont need the registry either.
+        ServerMessageType message_type{};
+        memcpy(&message_type, &message.content[0], sizeof(ServerMessageType));
+
+        // ===== Heartbeat =====
+        if (message_type == MessagePing) {
+                if (message.content_length < sizeof(ServerMessageType) + sizeof(u64)) return;
+
+                Message pong{};
+                pong.channel        = ChannelIDServer;
+                pong.content_length = sizeof(ServerMessageType) + sizeof(u64);
+
+                ServerMessageType pong_type = MessagePong;
+                memcpy(&pong.content[0], &pong_type, sizeof(ServerMessageType));
+                memcpy(&pong.content[4], &message.content[4], sizeof(u64));
+
+                // NOTE: Not worth disconnecting over, the client will ping again.
+                SendLocal(*current_shard, user_id, MakeSharedFrame(pong, FrameMessage, OverflowPolicy::Drop));
+                return;
+        }
+
+        if (message_type == MessageHistoryRequest) {
+                if (message.content_length < sizeof(ServerMessageType) + sizeof(ChannelID) + sizeof(u64) + sizeof(u8) + sizeof(u16)) return;
+
+                ChannelID        channel_id;
+                u64              cursor;
+                HistoryDirection direction;
+                u16              limit;
+                memcpy(&channel_id, &message.content[4], sizeof(ChannelID));
+                memcpy(&cursor, &message.content[8], sizeof(u64));
+                memcpy(&direction, &message.content[16], sizeof(u8));
+                memcpy(&limit, &message.content[17], sizeof(u16));
+
+                SendHistory(user_id, channel_id, cursor, direction, limit);
+                return;
+        }
+
+        std::lock_guard lock(registry_mutex);
+
+        User* user = users.Get(user_id);
+        if (user == nullptr) return;
+
+        ProcessMessage(this, *user, message);
+}
+
+// The page is made up of whatever the log has written, sent straight out of the mapped segments, and then whatever is newer from the
+// channels in memory history.
+void Server::SendHistory(UserID user_id, ChannelID channel_id, u64 cursor, HistoryDirection direction, u32 limit) {
+        Shard& shard = *current_shard;
+        limit        = std::clamp(limit, 1u, (u32)MAX_HISTORY_PAGE);
+
+        std::vector<SharedFrame> frames;
+        u64                      first_seq = 0;
+        u64                      next_seq  = 0;
+        u64                      last_seq  = 0;
+
+        // ===== Only Members Can Read A Channel =====
+        // NOTE: The user is on this shard, it sent the request.
+        CachedChannel*        cached  = LoadCachedChannel(shard, channel_id);
+        ChannelRoute*         route   = cached != nullptr ? cached->route.get() : nullptr;
+        const ChannelMembers* members = cached != nullptr ? cached->members.get() : nullptr;
+
+        bool is_member = members != nullptr and members->users.Contains(user_id);
+
+        if (is_member) {
+                {
+                        std::lock_guard lock(route->history_mutex);
+                        last_seq = route->last_seq;
+                }
+
+                // ===== Work Out The Range, [begin, end) =====
+                u64 begin;
+                u64 end;
+                if (direction == HistoryBefore) {
+                        end   = (cursor == 0 or cursor > last_seq) ? last_seq + 1 : cursor;
+                        begin = end > limit ? end - limit : 1;
+                } else {
+                        begin = std::min(cursor, last_seq) + 1;
+                        end   = std::min(last_seq + 1, begin + limit);
+                }
+
+                // ===== Older Messages From The Log =====
+                if (log_enabled and begin < end) log.ReadFrames(channel_id, begin, (u32)(end - begin), frames);
+
+                // NOTE: The log starts later than begin if it is missing older messages, it never reads past end.
+                if (!frames.empty()) memcpy(&first_seq, &frames[0]->data[FRAME_SEQ_OFFSET], sizeof(u64));
+                else first_seq = 0;
+                next_seq = first_seq + frames.size();
+
+                // ===== Newer Ones The Writer Hasnt Got To From Memory =====
+                std::lock_guard lock(route->history_mutex);
+
+                MessageHistory& history = route->history;
+                if (history.Count() > 0) {
+                        u64 oldest_seq = history.Get(0).seq;
+
+                        // NOTE: Only carry on from the log if there is no gap between them.
+                        u64 seq = frames.empty() ? std::max(begin, oldest_seq) : next_seq;
+                        for (; seq < end and seq >= oldest_seq and seq - oldest_seq < history.Count(); seq++) {
+                                HistoryEntry& entry = history.Get((u32)(seq - oldest_seq));
+                                if (entry.seq != seq) break;
+
+                                Message message{};
+                                message.sender         = entry.sender;
+                                message.channel        = channel_id;
+                                message.timestamp      = entry.timestamp;
+                                message.seq            = entry.seq;
+                                message.content_length = entry.content_length;
+                                memcpy(message.content, entry.content, entry.content_length);
+
+                                if (frames.empty()) first_seq = seq;
+                                frames.push_back(MakeSharedFrame(message));
+                                next_seq = seq + 1;
+                        }
+                }
+        }
+
+        // ===== Page, Then Its Frames =====
+        // NOTE: Nothing else can be queued to the user in between, this shard is the only one that touches its connection.
+        u32  count    = (u32)frames.size();
+        bool has_more = count > 0 and (direction == HistoryBefore ? first_seq > 1 : next_seq <= last_seq);
+
+        Message page{};
+        page.channel = channel_id;
+
+        ServerMessageType message_type = MessageHistoryPage;
+        memcpy(&page.content[0], &message_type, sizeof(ServerMessageType));
+        memcpy(&page.content[4], &channel_id, sizeof(ChannelID));
+        memcpy(&page.content[8], &first_seq, sizeof(u64));
+        memcpy(&page.content[16], &count, sizeof(u32));
+        memcpy(&page.content[20], &direction, sizeof(u8));
+        memcpy(&page.content[21], &has_more, sizeof(u8));
+        page.content_length = 22;
+
+        SendLocal(shard, user_id, MakeSharedFrame(page));
+        for (const SharedFrame& frame : frames) {
+                SendLocal(shard, user_id, frame);
+        }
+}
+
+// A client connecting for the first time is told about Global and gets all its members. One that is reconnecting only gets the member
+// changes and the messages it missed, so a reconnect storm costs a page and a diff per client instead of every member list again.
+// NOTE: The user is already in Global, anything broadcast from now on reaches them as usual. The client holds those back until the page
+// arrives.
+void Server::ResyncUser(UserID user_id, const Message& hello) {
+        ResyncChannel known_channels[MAX_RESYNC_CHANNELS];
+        u64           client_epoch;
+        u32           known_count = ReadResyncHello(hello, client_epoch, known_channels);
+
+        {
+                std::lock_guard lock(registry_mutex);
+
+                User*    user           = users.Get(user_id);
+                Channel* global_channel = channels.Get(ChannelIDGlobal);
+                if (user == nullptr or global_channel == nullptr) return;
+
+                // ===== Global Members =====
+                // NOTE: A new connection is a new user, so Global is the only channel it can still be in. Private channels dont carry over.
+                const ResyncChannel* known_global = nullptr;
+                for (u32 channel_idx = 0; channel_idx < known_count; channel_idx++) {
+                        if (known_channels[channel_idx].id == ChannelIDGlobal) known_global = &known_channels[channel_idx];
+                }
+
+                if (known_global == nullptr) InformUserOfChannel(*user, *global_channel);
+                else SendMemberDiff(this, *user, *global_channel, known_global->members_version, client_epoch == epoch);
+        }
+
+        // ===== Missed Messages =====
+        // NOTE: Every channel gets a page, even an empty one, so the client always knows when it has caught up.
+        for (u32 channel_idx = 0; channel_idx < known_count; channel_idx++) {
+                ResyncChannel& known = known_channels[channel_idx];
+
+                // ===== At Most The Newest Page =====
+                // NOTE: Older messages are only loaded if the client scrolls back to them.
+                u64            cursor = known.last_seq;
+                CachedChannel* cached = LoadCachedChannel(*current_shard, known.id);
+                if (cached != nullptr) {
+                        ChannelRoute&   route = *cached->route;
+                        std::lock_guard lock(route.history_mutex);
+                        if (route.last_seq > MAX_HISTORY_PAGE) cursor = std::max(cursor, route.last_seq - MAX_HISTORY_PAGE);
+                }
+
+                SendHistory(user_id, known.id, cursor, HistoryAfter, MAX_HISTORY_PAGE);
+        }
+}
+
+// Every frame from a client comes through here. The first one has to be a hello with a version we still support.
+// Returns false if the client should be disconnected.
+bool Server::HandleFrame(Shard& shard, UserID user_id, FrameType type, Message& message) {
+        Connection* connection_slot = shard.connections.Get(user_id);
+        if (connection_slot == nullptr) return false;
+
+        Connection& connection = *connection_slot;
+
+        // ===== Version Negotiation =====
+        if (connection.version == 0) {
+                if (type != FrameHello or message.content_length < 1) {
+                        std::println("Client {} did not send a hello", user_id);
+                        return false;
+                }
+
+                u8 client_version = (u8)message.content[0];
+                if (client_version < min_protocol_version) {
+                        std::println("Client {} has unsupported protocol version {}", user_id, client_version);
+                        return false;
                 }
+
+                connection.version = std::min(client_version, protocol_version);
+
+                ResyncUser(user_id, message);
+                return true;
+        }
+
+        if (type != FrameMessage) return true;
+
+        HandleMessage(user_id, message);
+        return true;
+}
+
+// Handles every complete frame in the ring, a partial frame is left for the next read.
+// Returns false if the client should be disconnected.
+bool Server::HandleFrames(Shard& shard, UserID user_id, RecvRing& recv_ring) {
+        Message   message;
+        FrameType type;
+        u32       frame_size;
+        bool      invalid;
+
+        // NOTE: Anything at all counts, a client only pings when it has nothing else to send.
+        shard.connections.last_heard_ms[SlotIndex(user_id)] = shard.now_ms;
+
+        while (const char* frame = recv_ring.NextFrame(frame_size, invalid)) {
+                DecodeFrame(frame, type, message);
+                recv_ring.Consume(frame_size);
+
+                if (!HandleFrame(shard, user_id, type, message)) return false;
+        }
+
+        if (invalid) std::println("Client {} sent an invalid frame", user_id);
+
+        return !invalid;
+}
+
+// Called when the poller reports the users socket as readable.
+// Returns false if the connection was closed, the caller is then responsible for disconnecting the user.
+bool ReceiveFromClient(Server* server, Shard& shard, Connection& connection, UserID user_id) {
+        int res = connection.recv_ring->Fill(shard.connections.sockets[SlotIndex(user_id)]);
+        if (res < 0 and SocketWouldBlock()) return true;
+
+        if (res <= 0) {
+                std::println("Recieve failed");
+                return false;
+        }
+
+        return server->HandleFrames(shard, user_id, *connection.recv_ring);
+}
+
+// NOTE: Send message to all client to tell them the server is down.
+void Server::DisconnectUser(Shard& shard, UserID user_id) {
+        if (!shard.connections.Contains(user_id)) return;
+
+        SOCKET socket = shard.connections.sockets[SlotIndex(user_id)];
+        shard.connections.Remove(user_id);
+
+#ifdef LINUX
+        if (backend == ServerBackend::Uring) shard.uring.RemoveConnection(user_id);
+#endif
+        if (backend == ServerBackend::Poll) {
+                shard.poller.Remove(socket);
+                closesocket(socket);
         }
 
-        closesocket(user.socket);
+        std::lock_guard lock(registry_mutex);
+
+        User* user_slot = users.Get(user_id);
+        if (user_slot == nullptr) return;
+
+        User& user = *user_slot;
 
         // ===== Send Leave Message =====
         // NOTE: MUST BE BEFORE WE TRY REMOVE!
-        SendUserLeave(server, user);
+        SendUserLeave(this, user);
 
         // ===== Remove from all channels =====
         for (u32 channel_idx = 0; channel_idx < user.channel_count; channel_idx++) {
                 ChannelID channel_id = user.channels[channel_idx];
 
-                LeaveChannel(server, user, channel_id);
+                LeaveChannel(this, user, channel_id);
         }
 
-        server->users.erase(user.id);
+        users.Remove(user_id);
+}
+
+void Server::DisconnectIdle(Shard& shard) {
+        if (idle_timeout_ms == 0 or shard.now_ms < shard.next_idle_check_ms) return;
+        shard.next_idle_check_ms = shard.now_ms + IDLE_CHECK_INTERVAL_MS;
+
+        // NOTE: Walks only the ids and times, DisconnectUser clears the slot without moving any others.
+        ConnectionTable& connections = shard.connections;
+        for (u32 idx = 0; idx < connections.ids.size(); idx++) {
+                UserID user_id = connections.ids[idx];
+                if (user_id == invalid_slot_id or shard.now_ms <= connections.last_heard_ms[idx] + idle_timeout_ms) continue;
+
+                std::println("Client {} timed out", user_id);
+                DisconnectUser(shard, user_id);
+        }
 }
 
 void Server::InformUserOfChannel(User& user, Channel& channel) {
@@ -469,107 +1443,274 @@ void Server::InformUserOfChannel(User& user, Channel& channel) {
         message.content_length += sizeof(UserID);
 
         // ===== Write Channel Name =====
-        memcpy(&message.content[message.content_length], channel.name.c_str(), channel.name.size());
-        message.content_length += (u32)channel.name.size();
+        // NOTE: Private channel names are two user names, so they can be longer than fits.
+        std::string_view channel_name = names.Get(channel.name).substr(0, message_buffer_length - message.content_length);
+        memcpy(&message.content[message.content_length], channel_name.data(), channel_name.size());
+        message.content_length += (u32)channel_name.size();
 
         // ===== Send Message =====
-        int send_flags = 0;
-        send(user.socket, (char*)&message, sizeof(Message), send_flags);
+        Send(user, message);
 
         SyncUsers(this, user);
 }
 
-ChannelID Server::CreateUserChannel(User& user, const std::string& name) {
-        ChannelID id = ChannelIDUser + custom_channel_count;
-        custom_channel_count++;
+ChannelID Server::CreateUserChannel(User& user, StringHandle name) {
+        ChannelID id = channels.Insert();
+        if (id == invalid_slot_id) return invalid_slot_id;
 
-        channels[id].id   = id;
-        channels[id].name = name;
+        Channel& channel = *channels.Get(id);
+        channel.id       = id;
+        channel.name     = name;
 
         // ===== Add Creator to Users =====
         AddUserToChannel(id, user.id);
 
         // ===== Inform =====
-        InformUserOfChannel(user, channels[id]);
+        InformUserOfChannel(user, channel);
 
         return id;
 }
 
-void Server::AddUserToChannel(ChannelID channel_id, UserID new_user_id) {
+void Server::AddUserToChannel(ChannelID channel_id, UserID new_user_id, bool inform_user) {
+        User*    new_user = users.Get(new_user_id);
+        Channel* channel  = channels.Get(channel_id);
+        if (new_user == nullptr or channel == nullptr) return;
+
         // ===== Add The User to Users List =====
-        channels[channel_id].users[channels[channel_id].user_count] = new_user_id;
-        channels[channel_id].user_count++;
+        if (new_user->channel_count == MAX_USER_CHANNELS) return;
+        if (!channel->users.Insert(new_user_id)) return; // Already a member.
+        RecordMemberChange(*channel, new_user_id, true);
+
+        new_user->channels[new_user->channel_count] = channel_id;
+        new_user->channel_count++;
 
-        users[new_user_id].channels[users[new_user_id].channel_count] = channel_id;
-        users[new_user_id].channel_count++;
+        PublishChannel(channel_id);
 
-        InformUserOfChannel(users[new_user_id], channels[channel_id]);
+        if (inform_user) InformUserOfChannel(*new_user, *channel);
+}
 
-        // ===== Broadcast the new user to all existing users =====
-        for (u32 user_idx = 0; user_idx < channels[channel_id].user_count; user_idx++) {
-                UserID user_id = channels[channel_id].users[user_idx];
-                if (user_id == new_user_id) continue; // dont send to ourselves.
+void Server::AcceptClients(Shard& shard) {
+        // ===== Accept Until The Backlog Is Empty =====
+        while (true) {
+                SOCKET client_socket = accept(listener_socket, NULL, NULL);
+                if (client_socket == INVALID_SOCKET) return;
 
-                User& user = users[user_id];
+                // NOTE: Left as accepted, ConnectUser makes it non blocking on the shard that owns it. Sends are queued, see SendQueue.
+                HandOffConnection(shard, client_socket);
+        }
+}
 
-                Message message{};
-                message.sender         = 0;
-                message.channel        = channel_id;
-                message.timestamp      = 0;
-                message.content_length = sizeof(ServerMessageType) + sizeof(UserID);
+void Server::HandOffConnection(Shard& shard, SOCKET client_socket) {
+        u32 target_index = next_shard % shards.size();
+        next_shard++;
 
-                ServerMessageType message_type = MessageUserJoin;
-                memcpy(&message.content[0], &message_type, sizeof(ServerMessageType));
+        if (target_index == shard.index) {
+                ConnectUser(shard, client_socket);
+                return;
+        }
+
+        // ===== The Target Shard Registers The Socket On Its Own Thread =====
+        Shard& target = *shards[target_index];
+        {
+                std::lock_guard lock(target.mailbox.mutex);
+                target.mailbox.accepted.push_back(client_socket);
+        }
+        WakeShard(target);
+}
+
+void Server::DrainMailbox(Shard& shard) {
+        std::vector<SOCKET>         accepted;
+        std::vector<ShardBroadcast> broadcasts;
+        {
+                std::lock_guard lock(shard.mailbox.mutex);
+                accepted.swap(shard.mailbox.accepted);
+                broadcasts.swap(shard.mailbox.broadcasts);
+        }
+
+        for (SOCKET client_socket : accepted) {
+                ConnectUser(shard, client_socket);
         }
+
+        // NOTE: Recipients may have disconnected since this was posted, SendLocal skips users we no longer have.
+        for (ShardBroadcast& broadcast : broadcasts) {
+                const std::vector<UserID>& recipients = broadcast.members ? broadcast.members->by_shard[shard.index] : broadcast.recipients;
+
+                for (UserID user_id : recipients) {
+                        SendLocal(shard, user_id, broadcast.frame);
+                }
+        }
+}
+
+User* Server::ConnectUser(Shard& shard, SOCKET client_socket) {
+        std::println("Successfully Connected");
+
+        std::lock_guard lock(registry_mutex);
+
+        // ===== Get User ID =====
+        UserID client_id = users.Insert();
+        if (client_id == invalid_slot_id) {
+                std::println("Too many users connected");
+                closesocket(client_socket);
+                return nullptr;
+        }
+
+        // ===== Add User Info =====
+        User& user         = *users.Get(client_id);
+        user.id            = client_id;
+        user.shard         = shard.index;
+        user.channel_count = 0;
+
+        // ===== Register With Backend =====
+        bool registered = false;
+#ifdef LINUX
+        UringConnection* uring_connection = nullptr;
+        if (backend == ServerBackend::Uring) {
+                uring_connection = shard.uring.AddConnection(client_id, client_socket);
+                registered       = uring_connection != nullptr;
+        }
+#endif
+        if (backend == ServerBackend::Poll) registered = shard.poller.Add(client_socket, client_id);
+
+        if (!registered) {
+                std::println("Failed watching client socket");
+                closesocket(client_socket);
+                users.Remove(client_id);
+                return nullptr;
+        }
+
+        Connection& connection = *shard.connections.Add(client_id, client_socket);
+#ifdef LINUX
+        shard.connections.uring_connections[SlotIndex(client_id)] = uring_connection;
+#endif
+        if (backend == ServerBackend::Poll) {
+                // NOTE: A client that stops reading must only ever fill its own send queue, never block the shard.
+                SetSocketBlocking(client_socket, false);
+                connection.recv_ring = std::make_unique<RecvRing>();
+        }
+
+        // ===== Tell The Client Our Version =====
+        // NOTE: Has to be the first frame, sent before anything else is queued for this user.
+        Message hello = HelloMessage();
+        memcpy(&hello.content[1], &epoch, sizeof(u64));
+        hello.content_length += sizeof(u64);
+
+        SendLocal(shard, client_id, MakeSharedFrame(hello, FrameHello));
+
+        // ===== Let User Know their ID =====
+        SendUserID(this, user);
+
+        // ===== Add to Global Channel =====
+        // NOTE: A member straight away so no message is missed, but what the client is sent about it waits for its hello.
+        AddUserToChannel(ChannelIDGlobal, client_id, false);
+
+        return &user;
 }
 
+// Starts every shard, pinning each to its own core. Shard 0 runs on the calling thread.
 // Want this to be runnable from a seperate thread, so that we can create a server GUI if we want.
-// Or make it a single run function which the user needs to call in a loop. Means we have no race conditions for checking server data.
-// However this would introduce latency between connects, but this would probably be not noticable compared to the latency of the network.
-// (obvously this doesnt apply to local networks).
 void Server::Run() {
+        if (shards.empty()) return; // Init failed.
+
         std::println("Waiting on Clients");
 
-        // NOTE: Without accounts we have no way to actually identify users if they are on the same pc,
-        // so we just have a rolling ID that resets every server run. When IDs are reused it doesnt matter,
-        // as the messages arnt stored. If they were, we would want to have unique IDs per user, so that we
-        // can still reference users.
-        UserID next_chat_id = 1; // Reserve 0 for server messages.
+        for (u32 shard_idx = 1; shard_idx < shards.size(); shard_idx++) {
+                Shard& shard = *shards[shard_idx];
+
+                if (backend == ServerBackend::Uring) shard.thread = std::thread(&Server::RunShardUring, this, std::ref(shard));
+                else shard.thread = std::thread(&Server::RunShard, this, std::ref(shard));
+        }
+
+        if (backend == ServerBackend::Uring) RunShardUring(*shards[0]);
+        else RunShard(*shards[0]);
+
+        for (u32 shard_idx = 1; shard_idx < shards.size(); shard_idx++) {
+                shards[shard_idx]->thread.join();
+        }
+}
+
+// Event loop for one shard. Every socket the shard owns is multiplexed through its poller, so idle clients cost nothing until they send
+// something.
+void Server::RunShard(Shard& shard) {
+        current_shard = &shard;
+        PinCurrentThreadToCore(shard.index % std::max(1u, std::thread::hardware_concurrency()));
+
+        PollEvent events[MAX_POLL_EVENTS];
 
         while (running) {
-                fd_set sockets_to_check{};
-                sockets_to_check.fd_count    = 1;
-                sockets_to_check.fd_array[0] = listener_socket;
-                timeval time_out_duration{ 0, 100 };
-                int     num_sockets_ready = select(0, &sockets_to_check, nullptr, nullptr, &time_out_duration);
-                if (num_sockets_ready == 0) continue;
-
-                SOCKET client_socket = INVALID_SOCKET;
-
-                client_socket = accept(listener_socket, NULL, NULL);
-                if (client_socket == INVALID_SOCKET) {
-                        continue;
+                // NOTE: Time out so we can check if the server is still running whilst waiting for messages.
+                int event_count = shard.poller.Wait(events, MAX_POLL_EVENTS, 100);
+                shard.now_ms    = MonotonicMs();
+                ReleaseRetiredChannels(shard);
+
+                for (int i = 0; i < event_count; i++) {
+                        PollEvent& event = events[i];
+
+                        if (event.key == listener_poll_key) {
+                                AcceptClients(shard);
+                                continue;
+                        }
+
+                        // ===== Find Connection =====
+                        // NOTE: A user can be removed by an earlier event in this batch.
+                        UserID      user_id    = (UserID)event.key;
+                        Connection* connection = shard.connections.Get(user_id);
+                        if (connection == nullptr) continue;
+
+                        bool connected = true;
+                        if (event.flags & PollReadable) connected = ReceiveFromClient(this, shard, *connection, user_id);
+                        else if (event.flags & PollClosed) connected = false;
+
+                        if (connected and (event.flags & PollWritable)) connected = FlushConnection(shard, user_id);
+
+                        if (!connected) DisconnectUser(shard, user_id);
                 }
 
-                std::println("Successfully Connected");
+                DrainMailbox(shard);
+                DisconnectIdle(shard);
+                FlushSends(shard);
+        }
+}
+
+// Completion based version of RunShard. Recvs land directly in the connections receive ring and every send queued while handling a batch of
+// completions is submitted together, so a broadcast to a whole channel costs one syscall instead of one per member.
+void Server::RunShardUring(Shard& shard) {
+#ifdef LINUX
+        current_shard = &shard;
+        PinCurrentThreadToCore(shard.index % std::max(1u, std::thread::hardware_concurrency()));
+
+        UringEvent events[MAX_POLL_EVENTS];
+
+        while (running) {
+                int event_count = shard.uring.Wait(events, MAX_POLL_EVENTS, 100);
+                shard.now_ms    = MonotonicMs();
+                ReleaseRetiredChannels(shard);
+
+                for (int i = 0; i < event_count; i++) {
+                        UringEvent& event = events[i];
 
-                // ===== Get User ID =====
-                UserID client_id = next_chat_id;
-                next_chat_id++;
+                        if (event.op == UringOpAccept) {
+                                HandOffConnection(shard, event.result);
+                                continue;
+                        }
+
+                        if (!shard.connections.Contains(event.user_id)) continue;
+
+                        RecvRing* recv_ring = shard.uring.GetRecvRing(event.user_id);
 
-                // ===== Add User Info =====
-                users[client_id].id            = client_id;
-                users[client_id].socket        = client_socket;
-                users[client_id].channel_count = 0;
+                        bool connected = event.result > 0 and recv_ring != nullptr;
+                        if (connected) connected = HandleFrames(shard, event.user_id, *recv_ring);
 
-                // ===== Let User Know their ID =====
-                SendUserID(this, users[client_id]);
+                        if (!connected) {
+                                DisconnectUser(shard, event.user_id);
+                                continue;
+                        }
 
-                // ===== Add to Global Channel =====
-                AddUserToChannel(ChannelIDGlobal, client_id);
+                        shard.uring.QueueRecv(event.user_id);
+                }
 
-                // ===== Assign Client to thread =====
-                client_threads[client_count] = std::thread(&ProcessClient, this, std::ref(users[client_id]), std::ref(running));
-                client_count++;
+                DrainMailbox(shard);
+                DisconnectIdle(shard);
+                FlushSends(shard);
         }
-}
\ No newline at end of file
+#endif
+}
@@ -1,10 +1,21 @@
 #pragma once
 
 #include "ChatApp.h"
+#include "Log.h"
 #include "Message.h"
+#include "Poller.h"
+#include "SlotMap.h"
+#include "Snapshot.h"
+#include "Uring.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 /*
 SERVER SETTINGS (adjustable from GUI):
@@ -27,30 +38,245 @@ NOTES:
         admins, and the user that created the channel defaults to an admin and can set other users as admins.
 */
 
-#define MAX_CUSTOM_CHANNELS 10'000
+constexpr u64 listener_poll_key = 0;
+
+// How the server waits on and talks to its sockets. Picked at startup, eg. "ChatApp.exe server uring 8".
+enum class ServerBackend {
+        Poll,  // Readiness based, epoll / WSAPoll.
+        Uring, // Completion based io_uring, batched submissions. Linux only.
+};
+
+/*
+OWNERSHIP:
+- Each shard is a reactor thread with its own poller (or ring). A connection belongs to exactly one shard for its whole life, only that
+  shard reads, writes or closes the socket. User::shard says which one.
+- The registry (users, channels, ids) is shared by all shards. Anything that changes it, or reads more than channel membership, holds
+  registry_mutex. Those are server messages, connects and disconnects, which are rare next to chat messages.
+- Chat messages never take registry_mutex. Every change to a channels members publishes a new immutable ChannelMembers snapshot and bumps
+  the routes members_version. A snapshot stays alive for as long as anyone is still using it, even after it has been replaced.
+- std::atomic<std::shared_ptr> is lock based, so shards dont load the directory or a snapshot for every message. Each shard keeps its own
+  copies, see Channel Cache, and only reloads one once its version has changed, which is a plain atomic load.
+- User and Channel references are stable, SlotMap pages never move. They are only invalidated by Remove, which happens under
+  registry_mutex.
+- Sending to a user on another shard never touches their socket, the encoded frame is posted to that shards mailbox once per shard (not once
+  per user) with the recipients, and the shard is woken to deliver it.
+*/
+
+// Who is in a channel, grouped by the shard that owns each member's connection. Never changed once published.
+struct ChannelMembers {
+        std::vector<std::vector<UserID>> by_shard;
+        MemberSet                        users; // All of them, so checking one user doesnt search a shards list.
+};
+
+using ChannelMembersPtr = std::shared_ptr<const ChannelMembers>;
+
+// One per channel for its whole life, so publishing new members doesnt need to touch the directory.
+struct ChannelRoute {
+        std::atomic<ChannelMembersPtr> members;
+        std::atomic<u64>               members_version{}; // Bumped after every store to members.
+
+        // NOTE: Per channel, chat messages on different channels never wait on each other. Also orders the channels appends to the log.
+        std::mutex     history_mutex;
+        MessageHistory history;
+        u64            last_seq{}; // Sequence number of the newest message in the channel.
+        bool           removed{};  // Set under history_mutex once the channel is removed, nothing is logged for it after that.
+};
+
+// Only copied and replaced when a channel is created or removed.
+using ChannelDirectory = std::unordered_map<ChannelID, std::shared_ptr<ChannelRoute>>;
+
+// A shards copy of what it has used of a channel, see Channel Cache.
+struct CachedChannel {
+        std::shared_ptr<ChannelRoute> route; // Held, so a route that was removed cant be confused with a new one at the same address.
+        u64                           members_version{ ~0ull };
+        ChannelMembersPtr             members;
+};
+
+struct ShardBroadcast {
+        SharedFrame         frame;
+        std::vector<UserID> recipients;
+        ChannelMembersPtr   members; // For channel broadcasts, the shard delivers to its own group instead of recipients.
+};
+
+struct ShardMailbox {
+        std::mutex                  mutex;
+        std::vector<SOCKET>         accepted; // Connections handed over by the accepting shard.
+        std::vector<ShardBroadcast> broadcasts;
+};
+
+enum ConnectionFlags : u8 {
+        ConnectionQueuedForFlush  = 1 << 0, // In the shards flush_list.
+        ConnectionWaitingWritable = 1 << 1, // The socket didnt take everything, the poller is watching for writability.
+        ConnectionOverflowed      = 1 << 2, // Went past its send queue limit, disconnected at the end of the loop iteration.
+};
+
+// Per connection state that is only needed when the connection itself reads or flushes, owned by the connections shard.
+struct Connection {
+        u8 version{}; // Negotiated protocol version, 0 until the clients hello arrives.
+
+        // Poll backend only, io_uring keeps its own so they can outlive reads and writes still in flight.
+        std::unique_ptr<RecvRing> recv_ring;
+        SendQueue                 send_queue;
+};
+
+// A shards connections, indexed by the users slot index so finding one is an array index. Struct of arrays so a fan out only walks what
+// queueing a frame needs, the id, flags and send queue of each recipient. Everything else stays behind the cold pointer.
+struct ConnectionTable {
+        Connection* Add(UserID user_id, SOCKET socket);
+        void        Remove(UserID user_id);
+        bool        Contains(UserID user_id) const;
+        Connection* Get(UserID user_id);
+
+        std::vector<UserID>     ids; // invalid_slot_id if empty. Whole IDs, so an older generation of the slot doesnt match.
+        std::vector<u8>         flags;
+        std::vector<SOCKET>     sockets;
+        std::vector<SendQueue*> send_queues;   // Poll backend, points into the cold Connection.
+        std::vector<u64>        last_heard_ms; // When the connection last sent us anything, for the idle timeout.
+#ifdef LINUX
+        std::vector<UringConnection*> uring_connections; // io_uring backend, its send queue lives in the ring.
+#endif
+
+        std::vector<std::unique_ptr<Connection>> cold;
+};
+
+// What the overflow policies did on one shard, printed on shutdown.
+struct OutboundStats {
+        u64 dropped{};
+        u64 coalesced{};
+        u64 overflow_disconnects{};
+};
+
+struct Shard {
+        u32         index;
+        std::thread thread;
+
+        Poller poller;
+#ifdef LINUX
+        UringBackend uring;
+#endif
+
+        // Only touched from this shards thread.
+        ConnectionTable connections;
+
+        ShardMailbox mailbox;
+
+        // Connections with frames queued this loop iteration.
+        std::vector<UserID> flush_list;
+        // Connections that overflowed this loop iteration.
+        std::vector<UserID> overflowed;
+        OutboundStats       outbound_stats;
+
+        u64 now_ms{};             // MonotonicMs at the top of this loop iteration.
+        u64 next_idle_check_ms{};
+
+        // ===== Channel Cache =====
+        // NOTE: Whatever is replaced is retired rather than freed, routes and members handed out stay valid until the next loop iteration.
+        std::shared_ptr<const ChannelDirectory>              directory;
+        u64                                                  directory_version{};
+        std::unordered_map<ChannelID, CachedChannel>         channels;
+        std::vector<std::shared_ptr<const ChannelDirectory>> retired_directories;
+        std::vector<ChannelMembersPtr>                       retired_members;
+};
 
 struct Server {
         // NOTE: Add flag to allow only a local server.
         void Init();
         void Shutdown();
 
+        // Runs shard 0 on the calling thread and the rest on their own threads. Returns once all shards have stopped.
         void Run();
+        void RunShard(Shard& shard);
+        void RunShardUring(Shard& shard);
+
+        void  AcceptClients(Shard& shard);
+        void  HandOffConnection(Shard& shard, SOCKET client_socket);
+        void  DrainMailbox(Shard& shard);
+        User* ConnectUser(Shard& shard, SOCKET client_socket);
+        void  DisconnectUser(Shard& shard, UserID user_id);
+        bool  HandleFrames(Shard& shard, UserID user_id, RecvRing& recv_ring);
+        bool  HandleFrame(Shard& shard, UserID user_id, FrameType type, Message& message);
+        void  HandleMessage(UserID user_id, Message& message);
+        // Sends a MessageHistoryPage and its frames, see History Pages. Must be called from the users shard.
+        void  SendHistory(UserID user_id, ChannelID channel_id, u64 cursor, HistoryDirection direction, u32 limit);
+        // Answers the clients hello with the member lists and messages it doesnt have yet, see Resync. Must be called from the users shard.
+        void  ResyncUser(UserID user_id, const Message& hello);
+
+        // All messages to clients go through here so the backend can batch them. Must be called from a shard thread.
+        void Send(User& user, const Message& message);
+        // Sends to every member of the channel, grouping members on other shards into one handoff per shard. Only locks the mailboxes of
+        // shards that have members, the members come from the Channel Cache.
+        void Broadcast(ChannelID channel_id, const Message& message);
+        void SendLocal(Shard& shard, UserID user_id, const SharedFrame& frame);
+        // Writes out everything queued this loop iteration, once per connection, and drops connections that overflowed.
+        void FlushSends(Shard& shard);
+        bool FlushConnection(Shard& shard, UserID user_id);
+        // Drops connections that have been silent for idle_timeout_ms, checked every IDLE_CHECK_INTERVAL_MS. See Heartbeat.
+        void DisconnectIdle(Shard& shard);
+        void WakeShard(Shard& shard);
 
         void      InformUserOfChannel(User& user, Channel& channel);
-        ChannelID CreateUserChannel(User& user, const std::string& name);
-        void      AddUserToChannel(ChannelID channel_id, UserID new_user_id);
+        ChannelID CreateUserChannel(User& user, StringHandle name);
+        // NOTE: Without inform_user the user isnt told until ResyncUser, used before the clients hello has arrived.
+        void      AddUserToChannel(ChannelID channel_id, UserID new_user_id, bool inform_user = true);
 
         WSADATA wsa_data;
         SOCKET  listener_socket{ INVALID_SOCKET };
 
-        int         client_count{};
-        std::thread client_threads[max_clients];
+        ServerBackend backend{ ServerBackend::Poll };
+
+        // 0 uses one shard per hardware thread.
+        u32                                 shard_count{};
+        std::vector<std::unique_ptr<Shard>> shards;
+        u32                                 next_shard{}; // Round robin for new connections, only used by shard 0.
+
+        u32 history_depth{ DEFAULT_HISTORY_DEPTH }; // Chat messages kept in memory per channel.
+        u32 idle_timeout_ms{ IDLE_TIMEOUT_MS };     // 0 never drops a connection for being idle.
+
+        // Different every run. Member versions from another run mean nothing, so a client resyncing with an old epoch gets full lists.
+        u64 epoch{};
+
+        // ===== Persistence =====
+        // NOTE: If the log cant be opened the server still runs, it just keeps history in memory only.
+        std::string log_directory{ "ChatLog" };
+        MessageLog  log;
+        bool        log_enabled{};
+
+        // Loads the newest snapshot and replays the log written after it. Call once the reserved channels exist, before the log is opened.
+        void Recover();
+        // Taken every snapshot_interval_ms on snapshot_thread while the log is enabled, and once more on shutdown.
+        void SnapshotLoop();
+        void CaptureSnapshot(Snapshot& snapshot);
+        void TakeSnapshot();
+
+        u32                     snapshot_interval_ms{ SNAPSHOT_INTERVAL_MS };
+        std::thread             snapshot_thread;
+        std::mutex              snapshot_mutex;
+        std::condition_variable snapshot_wake; // Only woken to stop early on shutdown.
+
+        // Rebuilds the channels member snapshot, call after every change to its users. Caller holds registry_mutex.
+        void PublishChannel(ChannelID channel_id);
+        void UnpublishChannel(ChannelID channel_id);
+        void StoreChannelDirectory(std::shared_ptr<const ChannelDirectory> directory);
+        // Any thread, takes the directorys lock. nullptr if the channel doesnt exist.
+        std::shared_ptr<ChannelRoute> LoadChannelRoute(ChannelID channel_id);
+        // Shard threads, from the shards Channel Cache. nullptr if the channel doesnt exist. Only valid until the next call, copy out the
+        // route or members, those stay valid until the next loop iteration.
+        CachedChannel* LoadCachedChannel(Shard& shard, ChannelID channel_id);
+        // Top of every loop iteration, frees what the Channel Cache replaced in the last one.
+        void           ReleaseRetiredChannels(Shard& shard);
+
+        // ===== Registry =====
+        std::mutex registry_mutex; // Writers only, see OWNERSHIP.
 
-        std::unordered_map<UserID, User>       users;
-        std::unordered_map<ChannelID, Channel> channels;
+        std::atomic<std::shared_ptr<const ChannelDirectory>> channel_directory;
+        std::atomic<u64>                                     directory_version{}; // Bumped after every store to channel_directory.
 
-        u32       custom_channel_count{};
-        ChannelID custom_channel_ids[MAX_CUSTOM_CHANNELS];
+        // NOTE: Without accounts we have no way to actually identify users if they are on the same pc, so IDs only last for a
+        // connection. Slots are reused once freed, the generation in the ID keeps an old ID from matching the new user, see Slot Map IDs.
+        // Handed out IDs are never 0, which is reserved for server messages.
+        SlotMap<User>    users;
+        SlotMap<Channel> channels;
+        StringTable      names; // User and channel names.
 
-        bool running;
+        std::atomic<bool> running;
 };
\ No newline at end of file
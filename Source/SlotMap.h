@@ -0,0 +1,210 @@
+#pragma once
+
+#include "Base.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// ===== Slot Map IDs =====
+// | generation: 8 | index: 24 |
+// The index says where the entity lives, so a lookup is an array index instead of a hash. Every time a slot is freed its generation goes
+// up, so an ID still sitting in a message or a mailbox stops matching and is rejected instead of finding whoever got the slot next.
+// Handed out IDs always have a generation of at least 1, generation 0 is left for reserved IDs like ChannelIDGlobal.
+// NOTE: The generation is only 8 bits, after 255 reuses of one slot an old ID matches again. Only ever a guard against stale IDs, never
+// proof two IDs are the same entity.
+
+#define SLOT_INDEX_BITS 24
+#define SLOT_PAGE_SIZE  1'024 // Slots are allocated a page at a time and pages never move, so references stay valid until the slot is freed.
+
+constexpr u32 slot_index_mask = (1u << SLOT_INDEX_BITS) - 1;
+constexpr u32 max_slot_count  = 1u << SLOT_INDEX_BITS;
+constexpr u32 invalid_slot_id = 0;
+
+inline u32 SlotIndex(u32 id) {
+        return id & slot_index_mask;
+}
+
+inline u8 SlotGeneration(u32 id) {
+        return (u8)(id >> SLOT_INDEX_BITS);
+}
+
+inline u32 MakeSlotID(u32 index, u8 generation) {
+        return ((u32)generation << SLOT_INDEX_BITS) | index;
+}
+
+// NOTE: Skips 0 on wrap around, that generation is only for reserved IDs.
+inline u8 NextSlotGeneration(u8 generation) {
+        generation++;
+        return generation == 0 ? 1 : generation;
+}
+
+template <typename T>
+struct SlotMap {
+        struct Slot {
+                T    value{};
+                u8   generation{};
+                bool alive{};
+        };
+
+        // Slots below first_index are only ever used through InsertReserved. Call before the first Insert.
+        void SetFirstIndex(u32 index) {
+                first_index = index;
+                if (slot_count < first_index) Grow(first_index);
+        }
+
+        // Returns the new ID, or invalid_slot_id if every slot is in use.
+        u32 Insert() {
+                u32 index;
+                if (!free_indices.empty()) {
+                        index = free_indices.back();
+                        free_indices.pop_back();
+                } else {
+                        if (slot_count == max_slot_count) return invalid_slot_id;
+
+                        index = slot_count;
+                        Grow(slot_count + 1);
+                }
+
+                Slot& slot = SlotAt(index);
+                slot.alive = true;
+                count++;
+
+                return MakeSlotID(index, slot.generation);
+        }
+
+        // For fixed IDs below first_index, they keep generation 0.
+        T& InsertReserved(u32 id) {
+                Slot& slot = SlotAt(id);
+                if (!slot.alive) count++;
+                slot.alive = true;
+
+                return slot.value;
+        }
+
+        void Remove(u32 id) {
+                if (Get(id) == nullptr) return;
+
+                u32   index = SlotIndex(id);
+                Slot& slot  = SlotAt(index);
+                slot.value  = {};
+                slot.alive  = false;
+                count--;
+
+                if (index < first_index) return;
+
+                // ===== Retire The ID =====
+                slot.generation = NextSlotGeneration(slot.generation);
+
+                free_indices.push_back(index);
+        }
+
+        // nullptr if the ID was never handed out, has been removed or is from an older generation of the slot.
+        T* Get(u32 id) {
+                u32 index = SlotIndex(id);
+                if (index >= slot_count) return nullptr;
+
+                Slot& slot = SlotAt(index);
+                if (!slot.alive or slot.generation != SlotGeneration(id)) return nullptr;
+
+                return &slot.value;
+        }
+
+        bool Contains(u32 id) {
+                return Get(id) != nullptr;
+        }
+
+        void Clear() {
+                pages.clear();
+                free_indices.clear();
+                slot_count = 0;
+                count      = 0;
+
+                Grow(first_index);
+        }
+
+        // The generation each slot would hand out next if everything in the map were removed now. Saved with snapshots, see
+        // RestoreGenerations.
+        std::vector<u8> RetiredGenerations() {
+                std::vector<u8> generations(slot_count);
+                for (u32 index = first_index; index < slot_count; index++) {
+                        Slot& slot         = SlotAt(index);
+                        generations[index] = slot.alive ? NextSlotGeneration(slot.generation) : slot.generation;
+                }
+
+                return generations;
+        }
+
+        // Only on a map with nothing but reserved slots in use, before the first Insert.
+        // Slots may have been used again between the snapshot and the restart. So every slot skips one more generation than saved, and
+        // slots the snapshot never saw start at 2 instead of 1. IDs that made it into the log are skipped past as well, see
+        // SkipGeneration, so only a slot reused more than once without ever being logged can hand out an ID from before the restart.
+        void RestoreGenerations(const std::vector<u8>& generations) {
+                if (generations.size() > max_slot_count) return;
+
+                // ===== Skip A Generation Everywhere =====
+                // NOTE: Before Grow, so pages made from here on start past the first generation too.
+                fresh_generation = NextSlotGeneration(1);
+                for (u32 index = first_index; index < pages.size() * SLOT_PAGE_SIZE; index++) {
+                        if (!SlotAt(index).alive) SlotAt(index).generation = fresh_generation;
+                }
+
+                if (generations.size() > slot_count) Grow((u32)generations.size());
+
+                for (u32 index = first_index; index < generations.size(); index++) {
+                        SlotAt(index).generation = NextSlotGeneration(std::max(generations[index], (u8)1));
+                }
+
+                RebuildFreeIndices();
+        }
+
+        // For an ID found in something that outlived the map, like the message log after a crash. A free slot moves past the IDs
+        // generation so the ID is never handed out again. Call RebuildFreeIndices once every ID has been seen.
+        void SkipGeneration(u32 id) {
+                u32 index      = SlotIndex(id);
+                u8  generation = SlotGeneration(id);
+                if (index < first_index or generation == 0) return;
+                if (index >= slot_count) Grow(index + 1);
+
+                Slot& slot = SlotAt(index);
+                if (slot.alive) return;
+
+                // NOTE: Only ever forward, counting the way generations wrap around.
+                if ((u8)(generation - slot.generation) < 128) slot.generation = NextSlotGeneration(generation);
+        }
+
+        // Only on a map with nothing but reserved slots in use. Every slot is free, lowest index handed out first.
+        void RebuildFreeIndices() {
+                free_indices.clear();
+                for (u32 index = slot_count; index-- > first_index;) {
+                        if (!SlotAt(index).alive) free_indices.push_back(index);
+                }
+        }
+
+        Slot& SlotAt(u32 index) {
+                return pages[index / SLOT_PAGE_SIZE][index % SLOT_PAGE_SIZE];
+        }
+
+        void Grow(u32 new_slot_count) {
+                while (pages.size() * SLOT_PAGE_SIZE < new_slot_count) {
+                        std::unique_ptr<Slot[]> page = std::make_unique<Slot[]>(SLOT_PAGE_SIZE);
+
+                        // NOTE: Handed out IDs start at generation 1 or later, so none of them can ever be 0 or a reserved ID.
+                        for (u32 i = 0; i < SLOT_PAGE_SIZE; i++) {
+                                u32 index          = (u32)pages.size() * SLOT_PAGE_SIZE + i;
+                                page[i].generation = index < first_index ? 0 : fresh_generation;
+                        }
+
+                        pages.push_back(std::move(page));
+                }
+
+                slot_count = new_slot_count;
+        }
+
+        std::vector<std::unique_ptr<Slot[]>> pages;
+        std::vector<u32>                     free_indices;
+        u32                                  slot_count{};          // Slots made so far, free or not.
+        u32                                  count{};               // Slots in use.
+        u32                                  first_index{};         // See SetFirstIndex.
+        u8                                   fresh_generation{ 1 }; // What slots start at when their page is made, see RestoreGenerations.
+};
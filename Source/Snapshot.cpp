@@ -0,0 +1,198 @@
+#include "ChatApp.h"
+#include "Log.h"
+#include "Snapshot.h"
+
+#include <filesystem>
+
+std::string SnapshotPath(const std::string& directory) {
+        return (std::filesystem::path(directory) / "snapshot.bin").string();
+}
+
+// ===== Encoding =====
+static void Put(std::vector<char>& out, const void* data, size_t size) {
+        size_t start = out.size();
+        out.resize(start + size);
+        memcpy(&out[start], data, size);
+}
+
+static bool Take(const std::vector<char>& in, size_t& offset, void* data, size_t size) {
+        if (in.size() - offset < size) return false;
+
+        memcpy(data, &in[offset], size);
+        offset += size;
+        return true;
+}
+
+static void PutGenerations(std::vector<char>& out, const std::vector<u8>& generations) {
+        u32 slot_count = (u32)generations.size();
+        Put(out, &slot_count, sizeof(u32));
+        Put(out, generations.data(), slot_count);
+}
+
+static bool TakeGenerations(const std::vector<char>& in, size_t& offset, std::vector<u8>& generations) {
+        u32 slot_count;
+        if (!Take(in, offset, &slot_count, sizeof(u32))) return false;
+        if (in.size() - offset < slot_count) return false;
+
+        generations.resize(slot_count);
+        return Take(in, offset, generations.data(), slot_count);
+}
+
+bool WriteSnapshot(const std::string& path, const Snapshot& snapshot) {
+        std::vector<char> out;
+
+        // ===== Write Header =====
+        u32 magic   = SNAPSHOT_MAGIC;
+        u32 version = SNAPSHOT_VERSION;
+        Put(out, &magic, sizeof(u32));
+        Put(out, &version, sizeof(u32));
+        Put(out, &snapshot.log_segment, sizeof(u64));
+
+        PutGenerations(out, snapshot.user_generations);
+        PutGenerations(out, snapshot.channel_generations);
+
+        // ===== Write Channels =====
+        u32 channel_count = (u32)snapshot.channels.size();
+        Put(out, &channel_count, sizeof(u32));
+
+        for (const SnapshotChannel& channel : snapshot.channels) {
+                u32 history_count = (u32)channel.history.size();
+                Put(out, &channel.id, sizeof(ChannelID));
+                Put(out, &channel.last_seq, sizeof(u64));
+                Put(out, &history_count, sizeof(u32));
+
+                for (const SnapshotMessage& message : channel.history) {
+                        u16 content_length = (u16)message.content.size();
+                        Put(out, &message.seq, sizeof(u64));
+                        Put(out, &message.sender, sizeof(UserID));
+                        Put(out, &message.timestamp, sizeof(TimeStamp));
+                        Put(out, &content_length, sizeof(u16));
+                        Put(out, message.content.data(), content_length);
+                }
+        }
+
+        // ===== Write Log Index =====
+        u32 index_channel_count = (u32)snapshot.log_index.size();
+        Put(out, &index_channel_count, sizeof(u32));
+
+        for (const auto& [channel_id, entries] : snapshot.log_index) {
+                u32 entry_count = (u32)entries.size();
+                Put(out, &channel_id, sizeof(ChannelID));
+                Put(out, &entry_count, sizeof(u32));
+
+                for (const LogIndexEntry& entry : entries) {
+                        Put(out, &entry.seq, sizeof(u64));
+                        Put(out, &entry.segment, sizeof(u64));
+                        Put(out, &entry.offset, sizeof(u64));
+                }
+        }
+
+        u32 checksum = LogChecksum(out.data(), (u32)out.size());
+        Put(out, &checksum, sizeof(u32));
+
+        // ===== Replace The Old Snapshot In One Step =====
+        // NOTE: Synced before the rename, otherwise a crash could leave the new name pointing at a half written file.
+        std::string temp_path = path + ".tmp";
+
+        FILE* file = fopen(temp_path.c_str(), "wb");
+        if (file == nullptr) return false;
+
+        bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+        written      = fflush(file) == 0 and written;
+        written      = SyncFile(file) and written;
+        fclose(file);
+
+        if (!written) return false;
+
+        std::error_code error;
+        std::filesystem::rename(temp_path, path, error);
+        return !error;
+}
+
+bool ReadSnapshot(const std::string& path, Snapshot& snapshot) {
+        std::vector<char> in;
+
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == nullptr) return false;
+
+        std::error_code error;
+        u64             size = std::filesystem::file_size(path, error);
+        if (!error) {
+                in.resize(size);
+                in.resize(fread(in.data(), 1, size, file));
+        }
+        fclose(file);
+
+        if (error or in.size() < sizeof(u32)) return false;
+
+        // ===== Check It Is Whole =====
+        u32 checksum;
+        memcpy(&checksum, &in[in.size() - sizeof(u32)], sizeof(u32));
+        in.resize(in.size() - sizeof(u32));
+        if (checksum != LogChecksum(in.data(), (u32)in.size())) return false;
+
+        // ===== Read Header =====
+        size_t offset = 0;
+        u32    magic;
+        u32    version;
+        if (!Take(in, offset, &magic, sizeof(u32)) or magic != SNAPSHOT_MAGIC) return false;
+        if (!Take(in, offset, &version, sizeof(u32)) or version != SNAPSHOT_VERSION) return false;
+        if (!Take(in, offset, &snapshot.log_segment, sizeof(u64))) return false;
+
+        if (!TakeGenerations(in, offset, snapshot.user_generations)) return false;
+        if (!TakeGenerations(in, offset, snapshot.channel_generations)) return false;
+
+        // ===== Read Channels =====
+        u32 channel_count;
+        if (!Take(in, offset, &channel_count, sizeof(u32))) return false;
+
+        snapshot.channels.clear();
+        for (u32 channel_idx = 0; channel_idx < channel_count; channel_idx++) {
+                SnapshotChannel& channel = snapshot.channels.emplace_back();
+
+                u32 history_count;
+                if (!Take(in, offset, &channel.id, sizeof(ChannelID))) return false;
+                if (!Take(in, offset, &channel.last_seq, sizeof(u64))) return false;
+                if (!Take(in, offset, &history_count, sizeof(u32))) return false;
+
+                for (u32 message_idx = 0; message_idx < history_count; message_idx++) {
+                        SnapshotMessage message{};
+
+                        u16 content_length;
+                        if (!Take(in, offset, &message.seq, sizeof(u64))) return false;
+                        if (!Take(in, offset, &message.sender, sizeof(UserID))) return false;
+                        if (!Take(in, offset, &message.timestamp, sizeof(TimeStamp))) return false;
+                        if (!Take(in, offset, &content_length, sizeof(u16))) return false;
+                        if (content_length > message_buffer_length or in.size() - offset < content_length) return false;
+
+                        message.content.assign(&in[offset], content_length);
+                        offset += content_length;
+
+                        channel.history.push_back(std::move(message));
+                }
+        }
+
+        // ===== Read Log Index =====
+        u32 index_channel_count;
+        if (!Take(in, offset, &index_channel_count, sizeof(u32))) return false;
+
+        snapshot.log_index.clear();
+        for (u32 channel_idx = 0; channel_idx < index_channel_count; channel_idx++) {
+                ChannelID channel_id;
+                u32       entry_count;
+                if (!Take(in, offset, &channel_id, sizeof(ChannelID))) return false;
+                if (!Take(in, offset, &entry_count, sizeof(u32))) return false;
+
+                std::vector<LogIndexEntry>& entries = snapshot.log_index[channel_id];
+                for (u32 entry_idx = 0; entry_idx < entry_count; entry_idx++) {
+                        LogIndexEntry entry;
+                        if (!Take(in, offset, &entry.seq, sizeof(u64))) return false;
+                        if (!Take(in, offset, &entry.segment, sizeof(u64))) return false;
+                        if (!Take(in, offset, &entry.offset, sizeof(u64))) return false;
+
+                        entries.push_back(entry);
+                }
+        }
+
+        return true;
+}
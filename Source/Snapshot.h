@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Base.h"
+#include "ChatApp.h"
+#include "Log.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ===== Snapshot =====
+// The servers state at one point in the message log, so a restart only replays the log written after it instead of all of it.
+// Written to a temporary file and renamed over the last one, so there is always a whole snapshot on disk.
+// | magic: u32 | version: u32 | log_segment: u64 |
+// | user_slot_count: u32 | generation: u8... | channel_slot_count: u32 | generation: u8... |
+// | channel_count: u32 | channels... | index_channel_count: u32 | channel indexes... | checksum: u32 |
+// channel: | id: u32 | last_seq: u64 | history_count: u32 | messages... |
+// message: | seq: u64 | sender: u32 | timestamp: u64 | content_length: u16 | content... |
+// channel index: | id: u32 | entry_count: u32 | entry: | seq: u64 | segment: u64 | offset: u64 |... |
+// The checksum covers everything before it.
+
+#define SNAPSHOT_MAGIC       0x4e'53'48'43 // "CHSN"
+#define SNAPSHOT_VERSION     3 // Version 3 indexes always end on each channels newest record.
+#define SNAPSHOT_INTERVAL_MS (30 * 1'000)
+
+struct SnapshotMessage {
+        u64         seq;
+        UserID      sender;
+        TimeStamp   timestamp;
+        std::string content;
+};
+
+struct SnapshotChannel {
+        ChannelID                    id;
+        u64                          last_seq;
+        std::vector<SnapshotMessage> history; // The channels in memory history, oldest first.
+};
+
+struct Snapshot {
+        // NOTE: Replay starts at this segment and skips any record a channel already has, every record in an earlier segment is covered.
+        u64 log_segment;
+
+        // From SlotMap::RetiredGenerations. Connections dont survive a restart, so these are all that is kept of the users.
+        std::vector<u8> user_generations;
+        std::vector<u8> channel_generations;
+
+        std::vector<SnapshotChannel> channels;
+
+        // The whole log index, so segments before log_segment dont have to be scanned to read them back.
+        std::unordered_map<ChannelID, std::vector<LogIndexEntry>> log_index;
+};
+
+bool        WriteSnapshot(const std::string& path, const Snapshot& snapshot);
+bool        ReadSnapshot(const std::string& path, Snapshot& snapshot); // False if there is none or it is damaged.
+std::string SnapshotPath(const std::string& directory);
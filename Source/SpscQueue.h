@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Base.h"
+
+#include <atomic>
+#include <memory>
+
+// ===== Single Producer Single Consumer Queue =====
+// A fixed size ring between exactly two threads, one only pushes and the other only pops. Neither side locks or waits, each only writes its
+// own index and reads the other ones with acquire, so an item is completely written before the consumer can see it.
+// The indexes are on their own cache lines so the two threads dont keep taking the line from each other.
+
+#define CACHE_LINE_SIZE 64
+
+template <typename T, u32 Capacity>
+struct SpscQueue {
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+        // Producer only. False if full, nothing is overwritten.
+        bool Push(const T& item) {
+                u32 tail = write_index.load(std::memory_order_relaxed);
+                if (tail - read_index.load(std::memory_order_acquire) == Capacity) return false;
+
+                items[tail & (Capacity - 1)] = item;
+                write_index.store(tail + 1, std::memory_order_release);
+                return true;
+        }
+
+        // Consumer only. The oldest item, or nullptr if empty. Stays valid until Pop.
+        T* Front() {
+                u32 head = read_index.load(std::memory_order_relaxed);
+                if (head == write_index.load(std::memory_order_acquire)) return nullptr;
+
+                return &items[head & (Capacity - 1)];
+        }
+
+        // Consumer only, after Front returned an item.
+        void Pop() {
+                read_index.store(read_index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // NOTE: Only while the producer isnt running, eg. after its thread has been joined.
+        void Clear() {
+                read_index.store(write_index.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
+        // NOTE: On the heap, a queue of messages is too big to sit inline wherever the queue is.
+        std::unique_ptr<T[]> items{ std::make_unique<T[]>(Capacity) };
+
+        // NOTE: Free running, only wrapped when indexing items. Their difference is the count even after they overflow.
+        alignas(CACHE_LINE_SIZE) std::atomic<u32> read_index{};  // Written by the consumer.
+        alignas(CACHE_LINE_SIZE) std::atomic<u32> write_index{}; // Written by the producer.
+};
@@ -0,0 +1,269 @@
+#include "Uring.h"
+
+#ifdef LINUX
+
+#include <algorithm>
+#include <sys/eventfd.h>
+
+// ===== User Data Layout =====
+// | op: 8 | unused: 24 | user id: 32 |
+static u64 PackUserData(UringOp op, UserID user_id) {
+        return ((u64)op << 56) | (u64)user_id;
+}
+
+static UringOp UnpackOp(u64 data) {
+        return (UringOp)(data >> 56);
+}
+
+static UserID UnpackUserID(u64 data) {
+        return (UserID)(data & 0xff'ff'ff'ff);
+}
+
+bool UringBackend::Init(SOCKET listener_socket) {
+        listener = listener_socket;
+
+        io_uring_params params{};
+
+        int res = io_uring_queue_init_params(URING_QUEUE_DEPTH, &ring, &params);
+        if (res < 0) {
+                std::println("Failed creating io_uring: {}", -res);
+                return false;
+        }
+
+        // ===== Wake Up =====
+        wake_fd = eventfd(0, EFD_CLOEXEC);
+        if (wake_fd == -1) return false;
+
+        QueueWakeRead();
+
+        if (listener != INVALID_SOCKET) QueueAccept();
+
+        return true;
+}
+
+void UringBackend::Wake() {
+        u64 value = 1;
+        write(wake_fd, &value, sizeof(value));
+}
+
+void UringBackend::QueueWakeRead() {
+        io_uring_sqe* sqe = GetSqe();
+        io_uring_prep_read(sqe, wake_fd, &wake_value, sizeof(wake_value), 0);
+        io_uring_sqe_set_data64(sqe, PackUserData(UringOpWake, 0));
+}
+
+void UringBackend::Shutdown() {
+        io_uring_queue_exit(&ring);
+
+        // NOTE: Live sockets belong to the server users and are closed there, only the ones it already removed are still ours.
+        for (auto& [user_id, connection] : connections) {
+                if (connection.closing) closesocket(connection.socket);
+        }
+        connections.clear();
+        flush_list.clear();
+
+        if (wake_fd != -1) close(wake_fd);
+        wake_fd = -1;
+}
+
+io_uring_sqe* UringBackend::GetSqe() {
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+        if (sqe != nullptr) return sqe;
+
+        // ===== Submission Queue Full, Flush Early =====
+        io_uring_submit(&ring);
+        return io_uring_get_sqe(&ring);
+}
+
+void UringBackend::QueueAccept() {
+        io_uring_sqe* sqe = GetSqe();
+        io_uring_prep_multishot_accept(sqe, listener, nullptr, nullptr, 0);
+        io_uring_sqe_set_data64(sqe, PackUserData(UringOpAccept, 0));
+}
+
+UringConnection* UringBackend::AddConnection(UserID user_id, SOCKET socket) {
+        UringConnection& connection = connections[user_id];
+        connection.socket           = socket;
+        connection.recv_ring        = std::make_unique<RecvRing>();
+
+        QueueRecv(user_id);
+
+        return &connection;
+}
+
+RecvRing* UringBackend::GetRecvRing(UserID user_id) {
+        auto connection_it = connections.find(user_id);
+        if (connection_it == connections.end() or connection_it->second.closing) return nullptr;
+
+        return connection_it->second.recv_ring.get();
+}
+
+void UringBackend::RemoveConnection(UserID user_id) {
+        auto connection_it = connections.find(user_id);
+        if (connection_it == connections.end() or connection_it->second.closing) return;
+
+        UringConnection& connection = connection_it->second;
+        connection.closing          = true;
+
+        // ===== Drop Sends That Never Made It To The Kernel =====
+        // NOTE: The frames in flight are released when the completion arrives.
+        connection.send_queue.Truncate(connection.sends_in_flight);
+
+        // NOTE: Only shut down so the pending recv and writev complete, see ReleaseIfIdle.
+        shutdown(connection.socket, SHUT_RDWR);
+
+        ReleaseIfIdle(connection_it);
+}
+
+void UringBackend::ReleaseIfIdle(std::unordered_map<UserID, UringConnection>::iterator connection_it) {
+        UringConnection& connection = connection_it->second;
+        if (!connection.closing or connection.recv_in_flight or connection.sends_in_flight > 0) return;
+
+        // NOTE: Closed only once nothing queued or in flight names the fd, otherwise an accept could reuse the number and a late recv or
+        // writev would land on the new connection.
+        closesocket(connection.socket);
+        connections.erase(connection_it);
+}
+
+void UringBackend::QueueRecv(UserID user_id) {
+        auto connection_it = connections.find(user_id);
+        if (connection_it == connections.end() or connection_it->second.closing) return;
+
+        UringConnection& connection = connection_it->second;
+
+        u32   length;
+        char* span = connection.recv_ring->WriteSpan(length);
+
+        io_uring_sqe* sqe = GetSqe();
+        io_uring_prep_recv(sqe, connection.socket, span, length, 0);
+        io_uring_sqe_set_data64(sqe, PackUserData(UringOpRecv, user_id));
+
+        connection.recv_in_flight = true;
+}
+
+PushResult UringBackend::QueueSend(UserID user_id, UringConnection& connection, const SharedFrame& frame) {
+        if (connection.closing) return PushResult::Dropped;
+
+        PushResult result = connection.send_queue.Push(frame, connection.sends_in_flight);
+        if (result == PushResult::Queued and !connection.queued_for_flush) {
+                connection.queued_for_flush = true;
+                flush_list.push_back(user_id);
+        }
+
+        return result;
+}
+
+void UringBackend::FlushSends() {
+        for (UserID user_id : flush_list) {
+                auto connection_it = connections.find(user_id);
+                if (connection_it == connections.end()) continue;
+
+                UringConnection& connection = connection_it->second;
+                connection.queued_for_flush = false;
+
+                // NOTE: If a writev is still in flight, its completion submits the rest.
+                if (connection.closing or connection.sends_in_flight > 0 or connection.send_queue.frames.empty()) continue;
+
+                SubmitSend(user_id, connection);
+        }
+
+        flush_list.clear();
+}
+
+void UringBackend::SubmitSend(UserID user_id, UringConnection& connection) {
+        SendQueue& send_queue  = connection.send_queue;
+        u32        frame_count = (u32)std::min(send_queue.frames.size(), (size_t)MAX_SEND_BATCH);
+
+        // NOTE: Only ever resized between writevs, the kernel may still be reading the iovecs of the one in flight.
+        if (connection.send_iovecs.size() < frame_count) connection.send_iovecs.resize(frame_count);
+
+        // ===== Gather Every Queued Frame =====
+        for (u32 i = 0; i < frame_count; i++) {
+                u32 start = i == 0 ? send_queue.offset : 0;
+                SetIoBuffer(connection.send_iovecs[i], (char*)send_queue.frames[i]->data + start, send_queue.frames[i]->size - start);
+        }
+
+        io_uring_sqe* sqe = GetSqe();
+        io_uring_prep_writev(sqe, connection.socket, connection.send_iovecs.data(), frame_count, 0);
+        io_uring_sqe_set_data64(sqe, PackUserData(UringOpSend, user_id));
+
+        connection.sends_in_flight = frame_count;
+}
+
+int UringBackend::Wait(UringEvent* events, int max_events, int timeout_ms) {
+        __kernel_timespec timeout{};
+        timeout.tv_sec  = timeout_ms / 1'000;
+        timeout.tv_nsec = (timeout_ms % 1'000) * 1'000'000;
+
+        FlushSends();
+
+        // ===== Submit Everything Queued This Iteration In One Syscall =====
+        io_uring_cqe* cqe = nullptr;
+        io_uring_submit_and_wait_timeout(&ring, &cqe, 1, &timeout, nullptr);
+
+        int      event_count = 0;
+        unsigned seen        = 0;
+        unsigned head;
+
+        io_uring_for_each_cqe(&ring, head, cqe) {
+                if (event_count == max_events) break;
+                seen++;
+
+                u64    data    = io_uring_cqe_get_data64(cqe);
+                UserID user_id = UnpackUserID(data);
+
+                switch (UnpackOp(data)) {
+                case UringOpWake: {
+                        QueueWakeRead();
+                } break;
+                case UringOpAccept: {
+                        // ===== Multishot Accept Stops On Errors, Rearm =====
+                        if (!(cqe->flags & IORING_CQE_F_MORE)) QueueAccept();
+                        if (cqe->res < 0) break;
+
+                        events[event_count++] = { UringOpAccept, 0, cqe->res };
+                } break;
+                case UringOpRecv: {
+                        auto connection_it = connections.find(user_id);
+                        if (connection_it == connections.end()) break;
+
+                        UringConnection& connection = connection_it->second;
+                        connection.recv_in_flight   = false;
+
+                        if (connection.closing) {
+                                ReleaseIfIdle(connection_it);
+                                break;
+                        }
+
+                        if (cqe->res > 0) connection.recv_ring->Commit((u32)cqe->res);
+
+                        events[event_count++] = { UringOpRecv, user_id, cqe->res };
+                } break;
+                case UringOpSend: {
+                        auto connection_it = connections.find(user_id);
+                        if (connection_it == connections.end()) break;
+
+                        UringConnection& connection = connection_it->second;
+                        connection.sends_in_flight   = 0;
+
+                        if (cqe->res < 0 or connection.closing) {
+                                // ===== Drop Sends, The Recv Side Will Notice The Connection Is Gone =====
+                                connection.send_queue.Truncate(0);
+
+                                ReleaseIfIdle(connection_it);
+                                break;
+                        }
+
+                        connection.send_queue.Consume((u32)cqe->res);
+
+                        if (!connection.send_queue.frames.empty()) SubmitSend(user_id, connection);
+                } break;
+                }
+        }
+
+        io_uring_cq_advance(&ring, seen);
+
+        return event_count;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+// io_uring backend for the server, an alternative to the readiness based Poller. Linux only.
+#ifdef LINUX
+
+#include "Base.h"
+#include "ChatApp.h"
+#include "Message.h"
+
+#include <liburing.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#define URING_QUEUE_DEPTH 4'096
+
+enum UringOp : u8 {
+        UringOpAccept,
+        UringOpRecv,
+        UringOpSend,
+        UringOpWake,
+};
+
+struct UringConnection {
+        SOCKET socket;
+
+        // Removed by the server but kept until the reads and writes still in flight complete, the kernel may still be using its buffers
+        // and the socket. Closed by the backend once they have.
+        bool closing{};
+
+        std::unique_ptr<RecvRing> recv_ring;
+        bool                      recv_in_flight{};
+
+        // NOTE: Only one writev is in flight per socket at a time, if the socket buffer fills up the kernel would otherwise be free to
+        // complete later writes first and reorder the stream. Everything queued behind it goes out together in the next one.
+        u32                sends_in_flight{}; // Frames at the front of the send queue covered by the writev in flight.
+        SendQueue          send_queue;
+        std::vector<iovec> send_iovecs; // Grown to the biggest writev so far, most connections never send more than a few frames at once.
+        bool               queued_for_flush{};
+};
+
+// The completions the server needs to act on. Sends are handled inside the backend.
+struct UringEvent {
+        UringOp op;
+        UserID  user_id; // Recv
+        i32     result;  // Accept: the new socket. Recv: bytes added to the users receive ring, <= 0 when the connection closed.
+};
+
+// Each connections queued frames are written with a single writev per loop iteration, straight out of the shared encoded frames. Recvs
+// read as much as is ready straight into the connections receive ring. Everything queued during a loop iteration is submitted together in
+// Wait.
+struct UringBackend {
+        // Pass INVALID_SOCKET as the listener if this ring shouldnt accept connections.
+        bool Init(SOCKET listener_socket);
+        void Shutdown();
+
+        // Makes a Wait on another thread return early. Safe to call from any thread.
+        void Wake();
+
+        // The connection stays at the same address until it is released, after RemoveConnection.
+        UringConnection* AddConnection(UserID user_id, SOCKET socket);
+        void RemoveConnection(UserID user_id);
+
+        // Queues the frame behind any other sends to this user, written out on the next Wait. The send queue limits apply.
+        PushResult QueueSend(UserID user_id, UringConnection& connection, const SharedFrame& frame);
+        // Rearm the recv once the frames in the receive ring have been handled.
+        void QueueRecv(UserID user_id);
+
+        RecvRing* GetRecvRing(UserID user_id);
+
+        // Submits everything queued since the last call and waits for at most timeout_ms. Returns the number of events written.
+        int Wait(UringEvent* events, int max_events, int timeout_ms);
+
+        io_uring_sqe* GetSqe();
+        void          QueueAccept();
+        void          QueueWakeRead();
+        void          FlushSends();
+        void          SubmitSend(UserID user_id, UringConnection& connection);
+        void          ReleaseIfIdle(std::unordered_map<UserID, UringConnection>::iterator connection_it);
+
+        io_uring ring;
+        SOCKET   listener;
+
+        int wake_fd{ -1 }; // eventfd, always has a read queued on it.
+        u64 wake_value;
+
+        std::unordered_map<UserID, UringConnection> connections;
+        std::vector<UserID>                         flush_list; // Connections with sends queued since the last Wait.
+};
+
+#endif
\ No newline at end of file
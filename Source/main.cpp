@@ -8,10 +8,29 @@
 
 #include "Server.h"
 
+#include <charconv>
+
 enum RunType { SERVER, CLIENT };
 
+static void PrintUsage() {
+        std::println("Usage: ChatApp [server [poll|uring] [shard_count] [history_depth] [interval|sync|os]]");
+        std::println("        shard_count   0 uses one shard per hardware thread.");
+        std::println("        history_depth Chat messages kept in memory per channel, at least 1.");
+}
+
+// Whole string must be a number that fits in a u32.
+static bool ParseU32(const char* text, u32& value) {
+        const char* end    = text + strlen(text);
+        auto [ptr, error] = std::from_chars(text, end, value);
+        return error == std::errc{} and ptr == end and ptr != text;
+}
+
 int main(int argc, char* argv[]) {
-        RunType run_type = CLIENT;
+        RunType       run_type      = CLIENT;
+        ServerBackend backend       = ServerBackend::Poll;
+        u32           shard_count   = 0;
+        u32           history_depth = DEFAULT_HISTORY_DEPTH;
+        LogDurability durability    = LogDurability::Interval;
 
         if (argc > 1) {
                 std::string type = argv[1];
@@ -19,16 +38,59 @@ int main(int argc, char* argv[]) {
                 if (type == "server") run_type = SERVER;
         }
 
+        if (argc > 2) {
+                std::string backend_name = argv[2];
+
+                if (backend_name == "uring") backend = ServerBackend::Uring;
+                else if (backend_name != "poll") {
+                        std::println("Unknown backend: {}", backend_name);
+                        PrintUsage();
+                        return 1;
+                }
+        }
+
+        if (argc > 3 and !ParseU32(argv[3], shard_count)) {
+                std::println("Invalid shard count: {}", argv[3]);
+                PrintUsage();
+                return 1;
+        }
+
+        if (argc > 4 and (!ParseU32(argv[4], history_depth) or history_depth == 0)) {
+                std::println("Invalid history depth: {}", argv[4]);
+                PrintUsage();
+                return 1;
+        }
+
+        if (argc > 5) {
+                std::string durability_name = argv[5];
+
+                if (durability_name == "sync") durability = LogDurability::EveryMessage;
+                else if (durability_name == "os") durability = LogDurability::OS;
+                else if (durability_name != "interval") {
+                        std::println("Unknown durability: {}", durability_name);
+                        PrintUsage();
+                        return 1;
+                }
+        }
+
         switch (run_type) {
         case SERVER: {
                 Server server;
+                server.backend        = backend;
+                server.shard_count    = shard_count;
+                server.history_depth  = history_depth;
+                server.log.durability = durability;
                 server.Init();
                 server.Run();
                 server.Shutdown();
         }
                 return 0;
         case CLIENT: {
+#ifdef WINDOWS
                 GUI();
+#else
+                std::println("The client is only supported on Windows, run with server to start a server.");
+#endif
         }
                 return 0;
         }
@@ -18,17 +18,19 @@ project "ChatApp"
    externalwarnings "Off"
    defines { "IMGUI_DEFINE_MATH_OPERATORS" }
 
-   links { "d3d12.lib", "d3dcompiler.lib", "dxgi.lib", "External/FMOD/lib/x64/fmod_vc.lib" }
-
    files { "Source/**.h", "Source/**.cpp", "External/imgui/backends/imgui_impl_dx12.cpp", "External/imgui/backends/imgui_impl_win32.cpp", "External/imgui/imgui*.cpp" }
 
    filter "platforms:Windows"
-      defines { "WINDOWS" }
+      defines { "WINDOWS", "NOMINMAX" } -- std::min and std::max instead of the windows.h macros.
       system ("windows")
+      links { "d3d12.lib", "d3dcompiler.lib", "dxgi.lib", "External/FMOD/lib/x64/fmod_vc.lib" }
 
+   -- Only the server is supported on Linux, the client is built on DirectX 12 and winsock.
    filter "platforms:Linux"
       defines { "LINUX" }
       system ("linux")
+      removefiles { "Source/GUI.cpp", "Source/Client.cpp", "External/imgui/backends/*.cpp" }
+      links { "pthread", "uring" }
 
    filter "configurations:Debug"
       defines { "DEBUG" }